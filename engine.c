@@ -1,24 +1,85 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
 #include "engine.h"
 
 #include <memory.h>
+#include <string.h>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_vulkan.h>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif
 #include "quit.h"
 #include "vulkan.h"
+#include "profiler.h"
+
+#define MAX_JOB_WORKERS 63
+//Power of two; also the most unfinished jobs a thread may have started.
+#define JOB_QUEUE_CAPACITY 4096
+#define JOB_SPIN_COUNT 256
+#define PARALLEL_FOR_JOBS_PER_THREAD 4
+#define FRAME_ARENA_INITIAL_SIZE ((size_t)4 * 1024 * 1024)
+//Frames after the arena last grew or the warm-up was restarted that may still allocate from the heap without tripping the debug assert.
+#define FRAME_ARENA_WARM_UP_FRAMES 120
+
+struct Job
+{
+	JobFunction function;
+	ParallelForFunction rangeFunction;
+	void* userData;
+	size_t begin;
+	size_t end;
+	JobCounter* counter;
+	Job* next;
+	//Set by the thread owning the pool, cleared by whichever thread starts running the job.
+	SDL_atomic_t inUse;
+};
 
 static SDL_Window* mainWindow;
 static float deltaTime;
 static uint64_t lastTimerValue;
 static bool scancodes[SDL_NUM_SCANCODES];
 static bool scancodesOnce[SDL_NUM_SCANCODES];
+static uint32_t headlessWidth;
+static uint32_t headlessHeight;
 VkInstance vkInstance;
 VkSurfaceKHR vkSurface;
 
+static bool IsInstanceExtensionAvailable(const char* name)
+{
+	uint32_t propertyCount = 0;
+	if(vkEnumerateInstanceExtensionProperties(NULL,&propertyCount,NULL) != VK_SUCCESS)
+	{
+		return false;
+	}
+	VkExtensionProperties* properties = malloc(propertyCount * sizeof(*properties));
+	if(!properties)
+	{
+		return false;
+	}
+	bool available = false;
+	if(vkEnumerateInstanceExtensionProperties(NULL,&propertyCount,properties) == VK_SUCCESS)
+	{
+		for(uint32_t i = 0;i < propertyCount && !available;++i)
+		{
+			available = strcmp(properties[i].extensionName,name) == 0;
+		}
+	}
+	free(properties);
+	return available;
+}
+
 static void InitVulkanAPI(void)
 {
+	//Without a window there is nothing to present to, so no surface extensions are needed.
 	unsigned extensionNameCount = 0;
-	if(!SDL_Vulkan_GetInstanceExtensions(mainWindow,&extensionNameCount,NULL))
+	if(mainWindow && !SDL_Vulkan_GetInstanceExtensions(mainWindow,&extensionNameCount,NULL))
 	{
 		AbortApplication("%s",SDL_GetError());
 	}
@@ -29,19 +90,25 @@ static void InitVulkanAPI(void)
 		So this weird #if is made to satisfy both compilers.
 	*/
 #if defined(_MSC_VER)
-	char** extensionNames = malloc(extensionNameCount * sizeof(*extensionNames));
+	char** extensionNames = malloc((extensionNameCount + 1) * sizeof(*extensionNames));
 #else
-	const char** extensionNames = malloc(extensionNameCount * sizeof(*extensionNames));
+	const char** extensionNames = malloc((extensionNameCount + 1) * sizeof(*extensionNames));
 #endif
 	if(!extensionNames)
 	{
-		AbortApplication("Couldn't allocate %zu bytes of memory.",extensionNameCount * sizeof(*extensionNames));
+		AbortApplication("Couldn't allocate %zu bytes of memory.",(extensionNameCount + 1) * sizeof(*extensionNames));
 	}
-	if(!SDL_Vulkan_GetInstanceExtensions(mainWindow,&extensionNameCount,extensionNames))
+	if(mainWindow && !SDL_Vulkan_GetInstanceExtensions(mainWindow,&extensionNameCount,extensionNames))
 	{
 		free(extensionNames);
 		AbortApplication("%s",SDL_GetError());
 	}
+	//Debug labels let external profilers and debuggers show the renderer's GPU scopes; they are only used when available.
+	bool debugUtilsEnabled = IsInstanceExtensionAvailable(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	if(debugUtilsEnabled)
+	{
+		extensionNames[extensionNameCount++] = (char*)VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+	}
 
 	VkApplicationInfo applicationInfo = {
 		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -67,6 +134,398 @@ static void InitVulkanAPI(void)
 	{
 		AbortApplication("Function vkCreateInstance returned %s.",VkResultToString(result));
 	}
+	if(debugUtilsEnabled)
+	{
+		LoadDebugUtilsFunctions(vkInstance);
+	}
+}
+
+//Chase-Lev deque: the owning thread pushes and pops at the bottom, other threads steal from the top.
+//Indices only grow (wrapping around), so sizes are computed as unsigned differences.
+typedef struct JobQueue
+{
+	SDL_atomic_t top;
+	char topPadding[64 - sizeof(SDL_atomic_t)];
+	SDL_atomic_t bottom;
+	char bottomPadding[64 - sizeof(SDL_atomic_t)];
+	Job* jobs[JOB_QUEUE_CAPACITY];
+} JobQueue;
+
+typedef struct JobThread
+{
+	JobQueue queue;
+	Job jobPool[JOB_QUEUE_CAPACITY];
+	uint32_t nextPoolIndex;
+	uint32_t randomState;
+	uint32_t index;
+	SDL_Thread* thread;
+} JobThread;
+
+typedef struct JobSystem
+{
+	//The main thread is threads[0]; workers are pinned to the cores after it.
+	JobThread* threads;
+	uint32_t threadCount;
+	SDL_TLSID threadIndexKey;
+	SDL_sem* wakeSemaphore;
+	SDL_atomic_t sleepingWorkerCount;
+	SDL_atomic_t quit;
+} JobSystem;
+
+static JobSystem jobSystem;
+
+//A half starts out as one chunk; when it runs out, bigger chunks are added in front and merged into one when the half is begun again.
+typedef struct FrameArenaChunk
+{
+	struct FrameArenaChunk* previous;
+	size_t size;
+	size_t used;
+} FrameArenaChunk;
+
+typedef struct FrameArenas
+{
+	FrameArenaChunk* halves[2];
+	uint32_t currentHalf;
+	//Frames since the engine started or the warm-up was last restarted.
+	uint64_t steadyFrameCount;
+	size_t heapAllocationCount;
+} FrameArenas;
+
+static FrameArenas frameArenas;
+
+static int GetQueueSize(int bottom,int top)
+{
+	return (int)((unsigned)bottom - (unsigned)top);
+}
+
+static bool PushJob(JobQueue* queue,Job* job)
+{
+	int bottom = SDL_AtomicGet(&queue->bottom);
+	if(GetQueueSize(bottom,SDL_AtomicGet(&queue->top)) >= JOB_QUEUE_CAPACITY)
+	{
+		return false;
+	}
+	queue->jobs[(unsigned)bottom % JOB_QUEUE_CAPACITY] = job;
+	//A full barrier, so thieves see the job before the new bottom and sleeping workers are counted after it.
+	SDL_AtomicAdd(&queue->bottom,1);
+	return true;
+}
+
+static Job* PopJob(JobQueue* queue)
+{
+	int bottom = SDL_AtomicAdd(&queue->bottom,-1) - 1;
+	int top = SDL_AtomicGet(&queue->top);
+	int size = GetQueueSize(bottom,top);
+	if(size < 0)
+	{
+		SDL_AtomicSet(&queue->bottom,top);
+		return NULL;
+	}
+	Job* job = queue->jobs[(unsigned)bottom % JOB_QUEUE_CAPACITY];
+	if(size > 0)
+	{
+		return job;
+	}
+	//The last job can be stolen at the same time, so whoever moves top first gets it.
+	if(!SDL_AtomicCAS(&queue->top,top,top + 1))
+	{
+		job = NULL;
+	}
+	SDL_AtomicSet(&queue->bottom,top + 1);
+	return job;
+}
+
+static Job* StealJob(JobQueue* queue)
+{
+	int top = SDL_AtomicGet(&queue->top);
+	int bottom = SDL_AtomicGet(&queue->bottom);
+	if(GetQueueSize(bottom,top) <= 0)
+	{
+		return NULL;
+	}
+	Job* job = queue->jobs[(unsigned)top % JOB_QUEUE_CAPACITY];
+	if(!SDL_AtomicCAS(&queue->top,top,top + 1))
+	{
+		return NULL;
+	}
+	return job;
+}
+
+static JobThread* GetCurrentJobThread(void)
+{
+	if(!jobSystem.threads)
+	{
+		return NULL;
+	}
+	uintptr_t index = (uintptr_t)SDL_TLSGet(jobSystem.threadIndexKey);
+	return (index > 0) ? &jobSystem.threads[index - 1] : NULL;
+}
+
+static Job* FindJob(JobThread* thread)
+{
+	Job* job = PopJob(&thread->queue);
+	if(job || jobSystem.threadCount < 2)
+	{
+		return job;
+	}
+	//Victims are tried from a random one onwards, so idle threads don't all hammer the same queue.
+	uint32_t x = thread->randomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	thread->randomState = x;
+	for(uint32_t i = 0;i < jobSystem.threadCount;++i)
+	{
+		uint32_t victim = (x + i) % jobSystem.threadCount;
+		if(victim != thread->index && (job = StealJob(&jobSystem.threads[victim].queue)))
+		{
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static void WakeWorkers(uint32_t jobCount)
+{
+	int sleepingWorkerCount = SDL_AtomicGet(&jobSystem.sleepingWorkerCount);
+	for(int i = 0;i < sleepingWorkerCount && (uint32_t)i < jobCount;++i)
+	{
+		SDL_SemPost(jobSystem.wakeSemaphore);
+	}
+}
+
+static void ExecuteJob(JobThread* thread,Job* job);
+
+static void FinishJob(JobThread* thread,JobCounter* counter)
+{
+	if(!counter)
+	{
+		return;
+	}
+	//Only the last job takes the lock, and decrements under it, so WaitForJobs can't return while the counter is still being used here.
+	int pendingCount = 0;
+	do
+	{
+		pendingCount = SDL_AtomicGet(&counter->pendingCount);
+	}
+	while(pendingCount > 1 && !SDL_AtomicCAS(&counter->pendingCount,pendingCount,pendingCount - 1));
+	if(pendingCount > 1)
+	{
+		return;
+	}
+	SDL_AtomicLock(&counter->lock);
+	SDL_AtomicAdd(&counter->pendingCount,-1);
+	Job* continuations = counter->continuations;
+	counter->continuations = NULL;
+	SDL_AtomicUnlock(&counter->lock);
+
+	uint32_t pushedCount = 0;
+	while(continuations)
+	{
+		Job* job = continuations;
+		continuations = job->next;
+		if(PushJob(&thread->queue,job))
+		{
+			++pushedCount;
+		}
+		else
+		{
+			ExecuteJob(thread,job);
+		}
+	}
+	WakeWorkers(pushedCount);
+}
+
+static void ExecuteJob(JobThread* thread,Job* job)
+{
+	//The slot is released before the job runs, so everything needed afterwards is copied out first.
+	Job copy = *job;
+	//A CAS is a full barrier, unlike SDL_AtomicSet, so the copy can't be reordered after the release; jobs on the stack were never marked.
+	SDL_AtomicCAS(&job->inUse,1,0);
+	BeginProfilerZone("Job");
+	if(copy.rangeFunction)
+	{
+		copy.rangeFunction(copy.userData,copy.begin,copy.end);
+	}
+	else
+	{
+		copy.function(copy.userData);
+	}
+	EndProfilerZone();
+	FinishJob(thread,copy.counter);
+}
+
+//Slots of queued and parked jobs stay in use until the jobs start, so they are skipped.
+//Returns NULL when all of them are taken; the caller then runs the job itself.
+static Job* AllocateJob(JobThread* thread,const Job* job)
+{
+	for(uint32_t i = 0;i < JOB_QUEUE_CAPACITY;++i)
+	{
+		Job* slot = &thread->jobPool[thread->nextPoolIndex++ % JOB_QUEUE_CAPACITY];
+		if(!SDL_AtomicGet(&slot->inUse))
+		{
+			*slot = *job;
+			SDL_AtomicSet(&slot->inUse,1);
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+//Affinity is only a hint; when it can't be set, the scheduler of the OS places the thread.
+static void PinCurrentThread(uint32_t core)
+{
+#if defined(_WIN32)
+	if(core < sizeof(DWORD_PTR) * 8)
+	{
+		SetThreadAffinityMask(GetCurrentThread(),(DWORD_PTR)1 << core);
+	}
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(core,&cpuSet);
+	pthread_setaffinity_np(pthread_self(),sizeof(cpuSet),&cpuSet);
+#else
+	(void)core;
+#endif
+}
+
+static int JobWorkerMain(void* userData)
+{
+	JobThread* thread = userData;
+	SDL_TLSSet(jobSystem.threadIndexKey,(void*)(uintptr_t)(thread->index + 1),NULL);
+	SetProfilerThreadName("JobWorker");
+	PinCurrentThread(thread->index % (uint32_t)SDL_GetCPUCount());
+	while(!SDL_AtomicGet(&jobSystem.quit))
+	{
+		Job* job = NULL;
+		for(uint32_t i = 0;i < JOB_SPIN_COUNT && !job;++i)
+		{
+			job = FindJob(thread);
+		}
+		if(job)
+		{
+			ExecuteJob(thread,job);
+			continue;
+		}
+		//Counting itself as sleeping before the last look prevents missing a job pushed in between, since the pusher reads the count after pushing.
+		SDL_AtomicAdd(&jobSystem.sleepingWorkerCount,1);
+		job = FindJob(thread);
+		if(!job && !SDL_AtomicGet(&jobSystem.quit))
+		{
+			SDL_SemWait(jobSystem.wakeSemaphore);
+		}
+		SDL_AtomicAdd(&jobSystem.sleepingWorkerCount,-1);
+		if(job)
+		{
+			ExecuteJob(thread,job);
+		}
+	}
+	return 0;
+}
+
+static void InitJobSystem(void)
+{
+	int cpuCount = SDL_GetCPUCount();
+	uint32_t workerCount = (cpuCount > 1) ? (uint32_t)cpuCount - 1 : 0;
+	if(workerCount > MAX_JOB_WORKERS)
+	{
+		workerCount = MAX_JOB_WORKERS;
+	}
+	jobSystem.threads = calloc(workerCount + 1,sizeof(*jobSystem.threads));
+	if(!jobSystem.threads)
+	{
+		AbortApplication("Couldn't allocate %zu bytes of memory.",(workerCount + 1) * sizeof(*jobSystem.threads));
+	}
+	jobSystem.threadIndexKey = SDL_TLSCreate();
+	jobSystem.wakeSemaphore = SDL_CreateSemaphore(0);
+	if(!jobSystem.threadIndexKey || !jobSystem.wakeSemaphore || SDL_TLSSet(jobSystem.threadIndexKey,(void*)(uintptr_t)1,NULL) != 0)
+	{
+		AbortApplication("%s",SDL_GetError());
+	}
+	//Queues of workers that haven't started yet are empty, so they can be stolen from already.
+	jobSystem.threadCount = workerCount + 1;
+	for(uint32_t i = 0;i <= workerCount;++i)
+	{
+		jobSystem.threads[i].index = i;
+		jobSystem.threads[i].randomState = 0x9E3779B9u * (i + 1);
+	}
+	for(uint32_t i = 1;i <= workerCount;++i)
+	{
+		JobThread* thread = &jobSystem.threads[i];
+		thread->thread = SDL_CreateThread(JobWorkerMain,"JobWorker",thread);
+		if(!thread->thread)
+		{
+			AbortApplication("%s",SDL_GetError());
+		}
+	}
+}
+
+static void TermJobSystem(void)
+{
+	if(!jobSystem.threads)
+	{
+		return;
+	}
+	SDL_AtomicSet(&jobSystem.quit,1);
+	for(uint32_t i = 1;i < jobSystem.threadCount;++i)
+	{
+		SDL_SemPost(jobSystem.wakeSemaphore);
+	}
+	for(uint32_t i = 1;i < jobSystem.threadCount;++i)
+	{
+		SDL_WaitThread(jobSystem.threads[i].thread,NULL);
+	}
+	SDL_DestroySemaphore(jobSystem.wakeSemaphore);
+	free(jobSystem.threads);
+	jobSystem = (JobSystem){0};
+}
+
+static FrameArenaChunk* CreateFrameArenaChunk(size_t size,FrameArenaChunk* previous)
+{
+	FrameArenaChunk* chunk = malloc(sizeof(*chunk) + size);
+	if(!chunk)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",sizeof(*chunk) + size);
+		return NULL;
+	}
+	*chunk = (FrameArenaChunk){
+		.previous = previous,
+		.size = size
+	};
+	CountFrameHeapAllocation();
+	return chunk;
+}
+
+static void FreeFrameArenaChunks(FrameArenaChunk* chunk)
+{
+	while(chunk)
+	{
+		FrameArenaChunk* previous = chunk->previous;
+		free(chunk);
+		chunk = previous;
+	}
+}
+
+static void InitFrameArenas(void)
+{
+	for(size_t i = 0;i < 2;++i)
+	{
+		frameArenas.halves[i] = CreateFrameArenaChunk(FRAME_ARENA_INITIAL_SIZE,NULL);
+		if(!frameArenas.halves[i])
+		{
+			AbortApplication(GetError());
+		}
+	}
+}
+
+static void TermFrameArenas(void)
+{
+	for(size_t i = 0;i < 2;++i)
+	{
+		FreeFrameArenaChunks(frameArenas.halves[i]);
+	}
+	frameArenas = (FrameArenas){0};
 }
 
 void InitEngine(void)
@@ -79,10 +538,33 @@ void InitEngine(void)
 	{
 		AbortApplication("%s",IMG_GetError());
 	}
+	InitProfiler();
+	InitJobSystem();
+	InitFrameArenas();
+}
+
+void InitHeadlessEngine(void)
+{
+	//The video subsystem fails on machines without a display, so only what the game loop needs is initialized.
+	if(SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) != 0)
+	{
+		AbortApplication("%s",SDL_GetError());
+	}
+	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG)
+	{
+		AbortApplication("%s",IMG_GetError());
+	}
+	InitProfiler();
+	InitJobSystem();
+	InitFrameArenas();
 }
 
 void TermEngine(void)
 {
+	TermJobSystem();
+	//Workers are joined by now, so no thread records zones while the exit trace is written.
+	TermProfiler();
+	TermFrameArenas();
 	if(vkInstance)
 	{
 		vkDestroySurfaceKHR(vkInstance,vkSurface,NULL);
@@ -110,8 +592,21 @@ void CreateMainWindow(const char* title,int width,int height)
 	}
 }
 
+void CreateHeadlessContext(int width,int height)
+{
+	headlessWidth = (uint32_t)width;
+	headlessHeight = (uint32_t)height;
+	InitVulkanAPI();
+}
+
+bool IsHeadless(void)
+{
+	return !mainWindow;
+}
+
 void ProcessEvents(void)
 {
+	BeginProfilerZone("ProcessEvents");
 	uint64_t currentTimerValue = SDL_GetPerformanceCounter();
 	memset(scancodesOnce,0,sizeof(scancodesOnce));
 	SDL_Event event = {0};
@@ -141,10 +636,25 @@ void ProcessEvents(void)
 	}
 	deltaTime = (float)(currentTimerValue - lastTimerValue) / SDL_GetPerformanceFrequency();
 	lastTimerValue = currentTimerValue;
+	EndProfilerZone();
+}
+
+void SetMainWindowTitle(const char* title)
+{
+	if(mainWindow)
+	{
+		SDL_SetWindowTitle(mainWindow,title);
+	}
 }
 
 void GetMainWindowSize(uint32_t* width,uint32_t* height)
 {
+	if(!mainWindow)
+	{
+		*width = headlessWidth;
+		*height = headlessHeight;
+		return;
+	}
 	int iwidth = 0;
 	int iheight = 0;
 	SDL_Vulkan_GetDrawableSize(mainWindow,&iwidth,&iheight);
@@ -154,7 +664,7 @@ void GetMainWindowSize(uint32_t* width,uint32_t* height)
 
 bool IsMainWindowMinimized(void)
 {
-	return SDL_GetWindowFlags(mainWindow) & SDL_WINDOW_MINIMIZED;
+	return mainWindow && (SDL_GetWindowFlags(mainWindow) & SDL_WINDOW_MINIMIZED);
 }
 
 float GetDeltaTime(void)
@@ -175,4 +685,261 @@ bool WasKeyPressed(SDL_Scancode key)
 void ResetTimer(void)
 {
 	lastTimerValue = SDL_GetPerformanceCounter();
-}
\ No newline at end of file
+}
+void RunJob(JobFunction function,void* userData,JobCounter* counter)
+{
+	JobThread* thread = GetCurrentJobThread();
+	if(!thread)
+	{
+		function(userData);
+		return;
+	}
+	if(counter)
+	{
+		SDL_AtomicAdd(&counter->pendingCount,1);
+	}
+	Job job = {
+		.function = function,
+		.userData = userData,
+		.counter = counter
+	};
+	Job* slot = AllocateJob(thread,&job);
+	if(!slot)
+	{
+		ExecuteJob(thread,&job);
+		return;
+	}
+	if(!PushJob(&thread->queue,slot))
+	{
+		ExecuteJob(thread,slot);
+		return;
+	}
+	WakeWorkers(1);
+}
+
+void RunJobAfter(JobCounter* dependency,JobFunction function,void* userData,JobCounter* counter)
+{
+	JobThread* thread = GetCurrentJobThread();
+	if(!thread)
+	{
+		WaitForJobs(dependency);
+		function(userData);
+		return;
+	}
+	if(counter)
+	{
+		SDL_AtomicAdd(&counter->pendingCount,1);
+	}
+	Job localJob = {
+		.function = function,
+		.userData = userData,
+		.counter = counter
+	};
+	Job* job = AllocateJob(thread,&localJob);
+	if(!job)
+	{
+		WaitForJobs(dependency);
+		ExecuteJob(thread,&localJob);
+		return;
+	}
+	//The last job of the dependency decrements it under the same lock, so the job is either queued here or picked up by FinishJob.
+	SDL_AtomicLock(&dependency->lock);
+	if(SDL_AtomicGet(&dependency->pendingCount) > 0)
+	{
+		job->next = dependency->continuations;
+		dependency->continuations = job;
+		SDL_AtomicUnlock(&dependency->lock);
+		return;
+	}
+	SDL_AtomicUnlock(&dependency->lock);
+	if(!PushJob(&thread->queue,job))
+	{
+		ExecuteJob(thread,job);
+		return;
+	}
+	WakeWorkers(1);
+}
+
+void ParallelFor(size_t count,size_t grainSize,ParallelForFunction function,void* userData,JobCounter* counter)
+{
+	JobThread* thread = GetCurrentJobThread();
+	if(grainSize == 0)
+	{
+		grainSize = (thread ? count / (jobSystem.threadCount * PARALLEL_FOR_JOBS_PER_THREAD) : count);
+	}
+	//A tiny grain over a huge range would fill the queue, so at most half of it is used.
+	size_t minGrainSize = (count + JOB_QUEUE_CAPACITY / 2 - 1) / (JOB_QUEUE_CAPACITY / 2);
+	if(grainSize < minGrainSize)
+	{
+		grainSize = minGrainSize;
+	}
+	if(grainSize == 0)
+	{
+		grainSize = 1;
+	}
+	if(!thread || count <= grainSize)
+	{
+		if(count > 0)
+		{
+			function(userData,0,count);
+		}
+		return;
+	}
+
+	if(counter)
+	{
+		SDL_AtomicAdd(&counter->pendingCount,(int)((count + grainSize - 1) / grainSize));
+	}
+	uint32_t pushedCount = 0;
+	for(size_t begin = 0;begin < count;begin += grainSize)
+	{
+		size_t end = ((count - begin) > grainSize) ? (begin + grainSize) : count;
+		Job localJob = {
+			.rangeFunction = function,
+			.userData = userData,
+			.begin = begin,
+			.end = end,
+			.counter = counter
+		};
+		Job* job = AllocateJob(thread,&localJob);
+		if(!job)
+		{
+			ExecuteJob(thread,&localJob);
+		}
+		else if(PushJob(&thread->queue,job))
+		{
+			++pushedCount;
+		}
+		else
+		{
+			ExecuteJob(thread,job);
+		}
+	}
+	WakeWorkers(pushedCount);
+}
+
+void WaitForJobs(JobCounter* counter)
+{
+	JobThread* thread = GetCurrentJobThread();
+	uint32_t idleCount = 0;
+	BeginProfilerZone("WaitForJobs");
+	while(SDL_AtomicGet(&counter->pendingCount) > 0)
+	{
+		Job* job = thread ? FindJob(thread) : NULL;
+		if(job)
+		{
+			ExecuteJob(thread,job);
+			idleCount = 0;
+		}
+		else if(++idleCount >= JOB_SPIN_COUNT)
+		{
+			SDL_Delay(0);
+		}
+	}
+	//The last FinishJob may still hold the lock, and the counter can only be freed or reused after it lets go.
+	SDL_AtomicLock(&counter->lock);
+	SDL_AtomicUnlock(&counter->lock);
+	EndProfilerZone();
+}
+
+uint32_t GetJobWorkerCount(void)
+{
+	return (jobSystem.threadCount > 0) ? (jobSystem.threadCount - 1) : 0;
+}
+
+#ifdef DEBUG_BUILD
+//Once warmed up, everything a frame needs should already fit into memory that was allocated earlier.
+static bool WasFrameHeapFree(void)
+{
+	return frameArenas.steadyFrameCount < FRAME_ARENA_WARM_UP_FRAMES || frameArenas.heapAllocationCount == 0;
+}
+#endif
+
+void BeginFrameArena(void)
+{
+#ifdef DEBUG_BUILD
+	SDL_assert(WasFrameHeapFree());
+#endif
+	++frameArenas.steadyFrameCount;
+	frameArenas.heapAllocationCount = 0;
+	frameArenas.currentHalf ^= 1;
+
+	FrameArenaChunk* chunk = frameArenas.halves[frameArenas.currentHalf];
+	if(chunk->previous)
+	{
+		//The half ran out two frames ago, so it's replaced by a single chunk that fits all of that frame's allocations.
+		size_t size = 0;
+		for(FrameArenaChunk* it = chunk;it;it = it->previous)
+		{
+			size += it->size;
+		}
+		FreeFrameArenaChunks(chunk);
+		chunk = CreateFrameArenaChunk(size,NULL);
+		if(!chunk)
+		{
+			AbortApplication(GetError());
+		}
+		frameArenas.halves[frameArenas.currentHalf] = chunk;
+	}
+	chunk->used = 0;
+}
+
+void* AllocateFrameMemory(size_t size,size_t alignment)
+{
+	FrameArenaChunk* chunk = frameArenas.halves[frameArenas.currentHalf];
+	uintptr_t base = (uintptr_t)(chunk + 1);
+	uintptr_t address = (base + chunk->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if(address + size > base + chunk->size)
+	{
+		size_t chunkSize = chunk->size * 2;
+		if(chunkSize < size + alignment)
+		{
+			chunkSize = size + alignment;
+		}
+		chunk = CreateFrameArenaChunk(chunkSize,chunk);
+		if(!chunk)
+		{
+			return NULL;
+		}
+		frameArenas.halves[frameArenas.currentHalf] = chunk;
+		base = (uintptr_t)(chunk + 1);
+		address = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+	chunk->used = address + size - base;
+	return (void*)address;
+}
+
+void RestartFrameArenaWarmUp(void)
+{
+	frameArenas.steadyFrameCount = 0;
+}
+
+#ifdef DEBUG_BUILD
+void CountFrameHeapAllocation(void)
+{
+	++frameArenas.heapAllocationCount;
+}
+
+bool TestFrameHeapAllocationCounter(void)
+{
+	//Pretends to be a frame long after the warm-up and makes the current half grow, which the assert has to catch.
+	FrameArenas savedArenas = frameArenas;
+	frameArenas.steadyFrameCount = FRAME_ARENA_WARM_UP_FRAMES;
+	frameArenas.heapAllocationCount = 0;
+	if(!AllocateFrameMemory(frameArenas.halves[frameArenas.currentHalf]->size + 1,1))
+	{
+		frameArenas = savedArenas;
+		return false;
+	}
+	bool reported = !WasFrameHeapFree();
+	//The new chunk sits in front of the old ones, which it didn't touch, so the arena is left as it was.
+	free(frameArenas.halves[frameArenas.currentHalf]);
+	frameArenas = savedArenas;
+	if(!reported)
+	{
+		SetError("Growing the frame arena in a steady frame wasn't reported as a heap allocation.");
+		return false;
+	}
+	return true;
+}
+#endif
\ No newline at end of file
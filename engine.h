@@ -1,14 +1,33 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <SDL_atomic.h>
 #include <SDL_scancode.h>
 
+typedef struct Job Job;
+typedef void (*JobFunction)(void* userData);
+typedef void (*ParallelForFunction)(void* userData,size_t begin,size_t end);
+
+//Counts the unfinished jobs started with it; it must be zero-initialized and stay alive until WaitForJobs returns.
+typedef struct JobCounter
+{
+	SDL_atomic_t pendingCount;
+	SDL_SpinLock lock;
+	Job* continuations;
+} JobCounter;
+
 void InitEngine(void);
+void InitHeadlessEngine(void);
 void TermEngine(void);
 void CreateMainWindow(const char* title,int width,int height);
+//Creates the Vulkan instance without a window; the renderer then draws into offscreen images of the given size.
+void CreateHeadlessContext(int width,int height);
+bool IsHeadless(void);
 void ProcessEvents(void);
+void SetMainWindowTitle(const char* title);
 void GetMainWindowSize(uint32_t* width,uint32_t* height);
 bool IsMainWindowMinimized(void);
 float GetDeltaTime(void);
@@ -16,4 +35,33 @@ bool IsKeyPressed(SDL_Scancode key);
 bool WasKeyPressed(SDL_Scancode key);
 void ResetTimer(void);
 
+//Jobs can be started from the main thread and from other jobs; any other thread runs them right away.
+//counter may be NULL. Once 4096 jobs started by the same thread are waiting to run, further ones run right away on it.
+void RunJob(JobFunction function,void* userData,JobCounter* counter);
+//Starts the job once dependency reaches zero, e.g. to chain stages without waiting on the calling thread.
+void RunJobAfter(JobCounter* dependency,JobFunction function,void* userData,JobCounter* counter);
+//Calls function over [0, count) split into ranges of at most grainSize elements; 0 picks a few ranges per worker.
+void ParallelFor(size_t count,size_t grainSize,ParallelForFunction function,void* userData,JobCounter* counter);
+//Runs queued jobs on the calling thread until counter reaches zero.
+void WaitForJobs(JobCounter* counter);
+//Not counting the main thread, which only runs jobs inside WaitForJobs.
+uint32_t GetJobWorkerCount(void);
+
+//Switches to the other half of the double-buffered frame arena; call it once at the start of every frame.
+//In debug builds it asserts that the last frame made no counted heap allocations, unless the arena grew or the warm-up was restarted shortly before.
+void BeginFrameArena(void);
+//Main thread only; alignment has to be a power of two. The memory stays valid during this frame and the next one,
+//so jobs may read it until then. Returns NULL and sets the error when the arena can't grow.
+void* AllocateFrameMemory(size_t size,size_t alignment);
+//Call it right where the work done per frame changes, e.g. on a game state change or a resize, since the next frames may legitimately need new memory.
+void RestartFrameArenaWarmUp(void);
+#ifdef DEBUG_BUILD
+//Called right after every heap allocation that can happen during a frame, including growing the frame arena itself.
+void CountFrameHeapAllocation(void);
+//Checks that a frame growing the arena after the warm-up would trip the assert; the arena is left unchanged.
+bool TestFrameHeapAllocationCounter(void);
+#else
+#define CountFrameHeapAllocation() ((void)0)
+#endif
+
 #endif
\ No newline at end of file
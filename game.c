@@ -0,0 +1,577 @@
+#include "game.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GAME_SIMD_AVX2
+#define BRICK_LANE_COUNT 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GAME_SIMD_SSE2
+#define BRICK_LANE_COUNT 4
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define GAME_SIMD_NEON
+#define BRICK_LANE_COUNT 4
+#else
+#define BRICK_LANE_COUNT 4
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <float.h>
+#include <string.h>
+
+//Overlap allowed at a contact for rounding errors in the time of impact.
+#define COLLISION_SKIN 0.01f
+#define MAX_BALL_CONTACTS_PER_STEP 16
+
+typedef enum BallContactType
+{
+	BALL_CONTACT_WALL,
+	BALL_CONTACT_PLAYER,
+	BALL_CONTACT_BRICK,
+} BallContactType;
+
+typedef struct BallContact
+{
+	BallContactType type;
+	float time;
+	Vec2 normal;
+	size_t brickIndex;
+} BallContact;
+
+//xorshift32; zero is the only state it can't leave, so it's never used.
+static uint32_t NextRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static bool AreColliding(const Box* a,const Box* b)
+{
+	return (a->position.x + a->size.x) >= b->position.x && a->position.x <= (b->position.x + b->size.x) && (a->position.y + a->size.y) >= b->position.y && a->position.y <= (b->position.y + b->size.y);
+}
+
+static uint32_t GetCellCoordinate(float value,float cellSize,uint32_t cellCount)
+{
+	if(value <= 0)
+	{
+		return 0;
+	}
+	uint32_t cell = (uint32_t)(value / cellSize);
+	return (cell < cellCount) ? cell : (cellCount - 1);
+}
+
+static uint32_t CountTrailingZeros(uint32_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index,value);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(value);
+#endif
+}
+
+static uint32_t CountBits(uint64_t value)
+{
+#if defined(__GNUC__)
+	return (uint32_t)__builtin_popcountll(value);
+#elif defined(_MSC_VER) && defined(__AVX2__)
+	return (uint32_t)__popcnt64(value);
+#else
+	value = value - ((value >> 1) & 0x5555555555555555ull);
+	value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+	value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (uint32_t)((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+//Returns one bit per brick in [first, first + BRICK_LANE_COUNT) that overlaps or touches the box, with the same comparisons as AreColliding.
+static uint32_t TestBrickLanes(const Bricks* bricks,size_t first,const Box* box)
+{
+	float boxMinX = box->position.x;
+	float boxMinY = box->position.y;
+	float boxMaxX = box->position.x + box->size.x;
+	float boxMaxY = box->position.y + box->size.y;
+#if defined(GAME_SIMD_AVX2)
+	__m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&bricks->maxX[first]),_mm256_set1_ps(boxMinX),_CMP_GE_OQ),_mm256_cmp_ps(_mm256_loadu_ps(&bricks->minX[first]),_mm256_set1_ps(boxMaxX),_CMP_LE_OQ));
+	hit = _mm256_and_ps(hit,_mm256_cmp_ps(_mm256_loadu_ps(&bricks->maxY[first]),_mm256_set1_ps(boxMinY),_CMP_GE_OQ));
+	hit = _mm256_and_ps(hit,_mm256_cmp_ps(_mm256_loadu_ps(&bricks->minY[first]),_mm256_set1_ps(boxMaxY),_CMP_LE_OQ));
+	return (uint32_t)_mm256_movemask_ps(hit);
+#elif defined(GAME_SIMD_SSE2)
+	__m128 hit = _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(&bricks->maxX[first]),_mm_set1_ps(boxMinX)),_mm_cmple_ps(_mm_loadu_ps(&bricks->minX[first]),_mm_set1_ps(boxMaxX)));
+	hit = _mm_and_ps(hit,_mm_cmpge_ps(_mm_loadu_ps(&bricks->maxY[first]),_mm_set1_ps(boxMinY)));
+	hit = _mm_and_ps(hit,_mm_cmple_ps(_mm_loadu_ps(&bricks->minY[first]),_mm_set1_ps(boxMaxY)));
+	return (uint32_t)_mm_movemask_ps(hit);
+#elif defined(GAME_SIMD_NEON)
+	static const uint32_t laneBits[4] = {1,2,4,8};
+	uint32x4_t hit = vandq_u32(vcgeq_f32(vld1q_f32(&bricks->maxX[first]),vdupq_n_f32(boxMinX)),vcleq_f32(vld1q_f32(&bricks->minX[first]),vdupq_n_f32(boxMaxX)));
+	hit = vandq_u32(hit,vcgeq_f32(vld1q_f32(&bricks->maxY[first]),vdupq_n_f32(boxMinY)));
+	hit = vandq_u32(hit,vcleq_f32(vld1q_f32(&bricks->minY[first]),vdupq_n_f32(boxMaxY)));
+	return vaddvq_u32(vandq_u32(hit,vld1q_u32(laneBits)));
+#else
+	uint32_t hits = 0;
+	for(uint32_t i = 0;i < BRICK_LANE_COUNT;++i)
+	{
+		size_t index = first + i;
+		hits |= (uint32_t)(bricks->maxX[index] >= boxMinX && bricks->minX[index] <= boxMaxX && bricks->maxY[index] >= boxMinY && bricks->minY[index] <= boxMaxY) << i;
+	}
+	return hits;
+#endif
+}
+
+static Vec2 GetBrickSize(const Game* game)
+{
+	float width = (float)GAME_WIDTH / (float)game->brickColumns;
+	return (Vec2){width,width / 4};
+}
+
+//The last cell of a row or column takes the remainder of the field, so cells are never smaller than cellSize.
+static uint32_t GetCellCount(float fieldSize,float cellSize)
+{
+	uint32_t cellCount = (uint32_t)(fieldSize / cellSize);
+	return (cellCount > 0) ? cellCount : 1;
+}
+
+//Cells start out as big as the biggest brick, so a brick can't span more than two of them along either axis.
+//Levels with many small bricks get bigger cells, so that the grid fits into MAX_BRICK_CELL_COUNT.
+static void SizeBrickCells(Bricks* bricks,const Box* boxes,size_t count)
+{
+	bricks->cellWidth = 1;
+	bricks->cellHeight = 1;
+	for(size_t i = 0;i < count;++i)
+	{
+		if(boxes[i].size.x > bricks->cellWidth)
+		{
+			bricks->cellWidth = boxes[i].size.x;
+		}
+		if(boxes[i].size.y > bricks->cellHeight)
+		{
+			bricks->cellHeight = boxes[i].size.y;
+		}
+	}
+	while(true)
+	{
+		bricks->cellColumns = GetCellCount(GAME_WIDTH,bricks->cellWidth);
+		bricks->cellRows = GetCellCount(GAME_HEIGHT,bricks->cellHeight);
+		if(bricks->cellColumns * bricks->cellRows <= MAX_BRICK_CELL_COUNT)
+		{
+			break;
+		}
+		if(bricks->cellColumns >= bricks->cellRows)
+		{
+			bricks->cellWidth *= 2;
+		}
+		else
+		{
+			bricks->cellHeight *= 2;
+		}
+	}
+}
+
+//Sorts the bricks by the cell of their top-left corner with a counting sort and stores them as structure of arrays.
+static void BuildBricks(Game* game,const Box* boxes,const uint8_t* variants,size_t count)
+{
+	Bricks* bricks = &game->bricks;
+	*bricks = (Bricks){
+		.count = count
+	};
+	SizeBrickCells(bricks,boxes,count);
+	uint32_t cellCount = bricks->cellColumns * bricks->cellRows;
+	uint32_t homeCells[MAX_BRICK_COUNT];
+	for(size_t i = 0;i < count;++i)
+	{
+		homeCells[i] = GetCellCoordinate(boxes[i].position.y,bricks->cellHeight,bricks->cellRows) * bricks->cellColumns + GetCellCoordinate(boxes[i].position.x,bricks->cellWidth,bricks->cellColumns);
+		++bricks->cellBegin[homeCells[i] + 1];
+	}
+	for(uint32_t i = 0;i < cellCount;++i)
+	{
+		bricks->cellBegin[i + 1] = (uint16_t)(bricks->cellBegin[i + 1] + bricks->cellBegin[i]);
+	}
+	uint16_t cellCursors[MAX_BRICK_CELL_COUNT];
+	for(uint32_t i = 0;i < cellCount;++i)
+	{
+		cellCursors[i] = bricks->cellBegin[i];
+	}
+	for(size_t i = 0;i < count;++i)
+	{
+		uint16_t index = cellCursors[homeCells[i]]++;
+		bricks->minX[index] = boxes[i].position.x;
+		bricks->minY[index] = boxes[i].position.y;
+		bricks->maxX[index] = boxes[i].position.x + boxes[i].size.x;
+		bricks->maxY[index] = boxes[i].position.y + boxes[i].size.y;
+		bricks->variants[index] = variants[i];
+		bricks->aliveMask[index / 64] |= 1ull << (index % 64);
+	}
+}
+
+//Time of impact of a box moving by displacement against a static box, as a fraction of the displacement, and the normal of the face it hits.
+//Boxes that already overlap by more than COLLISION_SKIN or that only touch while moving apart don't collide, so a resolved contact isn't found again.
+static bool SweepBox(const Box* box,Vec2 displacement,float minX,float minY,float maxX,float maxY,float* outTime,Vec2* outNormal)
+{
+	float entryX = -FLT_MAX;
+	float entryY = -FLT_MAX;
+	float exitX = FLT_MAX;
+	float exitY = FLT_MAX;
+	float gapX = 0;
+	float gapY = 0;
+	if(displacement.x > 0)
+	{
+		gapX = minX - (box->position.x + box->size.x);
+		entryX = gapX / displacement.x;
+		exitX = (maxX - box->position.x) / displacement.x;
+	}
+	else if(displacement.x < 0)
+	{
+		gapX = box->position.x - maxX;
+		entryX = gapX / -displacement.x;
+		exitX = ((box->position.x + box->size.x) - minX) / -displacement.x;
+	}
+	else if((box->position.x + box->size.x) < minX || box->position.x > maxX)
+	{
+		return false;
+	}
+	if(displacement.y > 0)
+	{
+		gapY = minY - (box->position.y + box->size.y);
+		entryY = gapY / displacement.y;
+		exitY = (maxY - box->position.y) / displacement.y;
+	}
+	else if(displacement.y < 0)
+	{
+		gapY = box->position.y - maxY;
+		entryY = gapY / -displacement.y;
+		exitY = ((box->position.y + box->size.y) - minY) / -displacement.y;
+	}
+	else if((box->position.y + box->size.y) < minY || box->position.y > maxY)
+	{
+		return false;
+	}
+
+	bool alongX = entryX > entryY;
+	float entry = alongX ? entryX : entryY;
+	float exit = (exitX < exitY) ? exitX : exitY;
+	if(entry == -FLT_MAX || entry > exit || entry > 1 || exit <= 0 || (alongX ? gapX : gapY) < -COLLISION_SKIN)
+	{
+		return false;
+	}
+	*outTime = (entry > 0) ? entry : 0;
+	*outNormal = alongX ? (Vec2){(displacement.x > 0) ? -1.0f : 1.0f,0} : (Vec2){0,(displacement.y > 0) ? -1.0f : 1.0f};
+	return true;
+}
+
+static void FindWallContact(const Box* ball,Vec2 displacement,bool hasFloor,BallContact* contact)
+{
+	float time = 0;
+	if(displacement.x < 0 && (time = ball->position.x / -displacement.x) < contact->time)
+	{
+		*contact = (BallContact){.type = BALL_CONTACT_WALL,.time = time,.normal = {1,0}};
+	}
+	if(displacement.x > 0 && (time = (GAME_WIDTH - (ball->position.x + ball->size.x)) / displacement.x) < contact->time)
+	{
+		*contact = (BallContact){.type = BALL_CONTACT_WALL,.time = time,.normal = {-1,0}};
+	}
+	if(displacement.y < 0 && (time = ball->position.y / -displacement.y) < contact->time)
+	{
+		*contact = (BallContact){.type = BALL_CONTACT_WALL,.time = time,.normal = {0,1}};
+	}
+	if(hasFloor && displacement.y > 0 && (time = (GAME_HEIGHT - (ball->position.y + ball->size.y)) / displacement.y) < contact->time)
+	{
+		*contact = (BallContact){.type = BALL_CONTACT_WALL,.time = time,.normal = {0,-1}};
+	}
+	//A ball that was pushed past a wall bounces off it right away.
+	if(contact->time < 0)
+	{
+		contact->time = 0;
+	}
+}
+
+//Finds the earliest hit among the alive bricks in [begin, end); the SIMD test against the box swept by the ball rejects most of them before the exact sweep.
+static void FindBrickContact(const Game* game,size_t begin,size_t end,const Box* ball,const Box* sweptBall,Vec2 displacement,BallContact* contact)
+{
+	const Bricks* bricks = &game->bricks;
+	for(size_t first = begin;first < end;first += BRICK_LANE_COUNT)
+	{
+		uint32_t hits = TestBrickLanes(bricks,first,sweptBall);
+		if((end - first) < BRICK_LANE_COUNT)
+		{
+			hits &= (1u << (end - first)) - 1;
+		}
+		while(hits)
+		{
+			size_t index = first + CountTrailingZeros(hits);
+			hits &= hits - 1;
+			float time = 0;
+			Vec2 normal = {0};
+			if(IsBrickAlive(game,index) && SweepBox(ball,displacement,bricks->minX[index],bricks->minY[index],bricks->maxX[index],bricks->maxY[index],&time,&normal) && time < contact->time)
+			{
+				*contact = (BallContact){.type = BALL_CONTACT_BRICK,.time = time,.normal = normal,.brickIndex = index};
+			}
+		}
+	}
+}
+
+void CreateGame(Game* game,uint32_t seed,uint32_t brickColumns,uint32_t brickRows)
+{
+	*game = (Game){
+		.state = GAME_STATE_MAIN_MENU,
+		.brickColumns = (brickColumns < 1) ? 1 : (brickColumns > MAX_BRICK_COLUMNS) ? MAX_BRICK_COLUMNS : brickColumns,
+		.randomState = seed ? seed : 0x9E3779B9u
+	};
+	uint32_t maxRows = (uint32_t)(BRICK_AREA_HEIGHT / GetBrickSize(game).y);
+	if(maxRows > MAX_BRICK_COUNT / game->brickColumns)
+	{
+		maxRows = MAX_BRICK_COUNT / game->brickColumns;
+	}
+	game->brickRows = (brickRows < 1) ? 1 : (brickRows > maxRows) ? maxRows : brickRows;
+}
+
+void ResetGame(Game* game)
+{
+	++game->roundIndex;
+	game->ball = (Box){
+		.position = {GAME_WIDTH / 2 - BALL_WIDTH / 2,386 - BALL_HEIGHT / 2},
+		.size = {BALL_WIDTH,BALL_HEIGHT}
+	};
+	game->ballVelocity = (Vec2){0,200};
+
+	game->player = (Box){
+		.position = {GAME_WIDTH / 2 - PLAYER_WIDTH / 2,GAME_HEIGHT - 48},
+		.size = {PLAYER_WIDTH,PLAYER_HEIGHT}
+	};
+
+	Box boxes[MAX_BRICK_COUNT];
+	uint8_t variants[MAX_BRICK_COUNT];
+	size_t count = 0;
+	Vec2 brickSize = GetBrickSize(game);
+	for(size_t y = 0;y < game->brickRows;++y)
+	{
+		for(size_t x = 0;x < game->brickColumns;++x)
+		{
+			boxes[count] = (Box){
+				.size = brickSize,
+				.position = {(float)x * brickSize.x,(float)y * brickSize.y}
+			};
+			variants[count] = (uint8_t)(NextRandom(&game->randomState) % BRICK_VARIANT_COUNT);
+			++count;
+		}
+	}
+	BuildBricks(game,boxes,variants,count);
+}
+
+//Moves the ball to its earliest contact, bounces it and carries on with the rest of deltaTime, so it can't pass through anything however long the step is.
+//Bricks it hits are cleared from aliveMask, which is either NULL or game->bricks.aliveMask; without a floor, the ball leaves through the bottom.
+static void MoveBall(const Game* game,Box* ball,Vec2* velocity,float deltaTime,float playerDeltaX,uint64_t* aliveMask,bool hasFloor)
+{
+	const Box* player = &game->player;
+	float remainingTime = deltaTime;
+	for(uint32_t contactIndex = 0;contactIndex < MAX_BALL_CONTACTS_PER_STEP && remainingTime > 0;++contactIndex)
+	{
+		Vec2 displacement = {velocity->x * remainingTime,velocity->y * remainingTime};
+		BallContact contact = {.time = FLT_MAX};
+		FindWallContact(ball,displacement,hasFloor,&contact);
+
+		float time = 0;
+		Vec2 normal = {0};
+		if(SweepBox(ball,displacement,player->position.x,player->position.y,player->position.x + player->size.x,player->position.y + player->size.y,&time,&normal) && time < contact.time)
+		{
+			contact = (BallContact){.type = BALL_CONTACT_PLAYER,.time = time,.normal = normal};
+		}
+
+		//A brick touching the box swept by the ball has its top-left corner in the swept cells or one cell left of or above them.
+		//Within a row the candidate bricks are contiguous, so each row is one run of SIMD tests.
+		Box sweptBall = {
+			.position = {ball->position.x + ((displacement.x < 0) ? displacement.x : 0),ball->position.y + ((displacement.y < 0) ? displacement.y : 0)},
+			.size = {ball->size.x + ((displacement.x < 0) ? -displacement.x : displacement.x),ball->size.y + ((displacement.y < 0) ? -displacement.y : displacement.y)}
+		};
+		const Bricks* bricks = &game->bricks;
+		uint32_t minCellX = GetCellCoordinate(sweptBall.position.x,bricks->cellWidth,bricks->cellColumns);
+		uint32_t minCellY = GetCellCoordinate(sweptBall.position.y,bricks->cellHeight,bricks->cellRows);
+		uint32_t maxCellX = GetCellCoordinate(sweptBall.position.x + sweptBall.size.x,bricks->cellWidth,bricks->cellColumns);
+		uint32_t maxCellY = GetCellCoordinate(sweptBall.position.y + sweptBall.size.y,bricks->cellHeight,bricks->cellRows);
+		minCellX -= (minCellX > 0);
+		minCellY -= (minCellY > 0);
+		for(uint32_t y = minCellY;y <= maxCellY;++y)
+		{
+			const uint16_t* rowCells = &bricks->cellBegin[y * bricks->cellColumns];
+			FindBrickContact(game,rowCells[minCellX],rowCells[maxCellX + 1],ball,&sweptBall,displacement,&contact);
+		}
+
+		if(contact.time > 1)
+		{
+			ball->position.x += displacement.x;
+			ball->position.y += displacement.y;
+			break;
+		}
+		ball->position.x += displacement.x * contact.time;
+		ball->position.y += displacement.y * contact.time;
+		remainingTime -= remainingTime * contact.time;
+		if(contact.normal.x != 0)
+		{
+			velocity->x *= -1;
+		}
+		if(contact.normal.y != 0)
+		{
+			velocity->y *= -1;
+		}
+		if(contact.type == BALL_CONTACT_PLAYER && contact.normal.y < 0)
+		{
+			velocity->x += playerDeltaX * 50;
+		}
+		else if(contact.type == BALL_CONTACT_BRICK && aliveMask)
+		{
+			aliveMask[contact.brickIndex / 64] &= ~(1ull << (contact.brickIndex % 64));
+		}
+	}
+}
+
+static void StepPlay(Game* game,const GameInput* input,float deltaTime)
+{
+	Box* player = &game->player;
+	Box* ball = &game->ball;
+	Vec2* ballVelocity = &game->ballVelocity;
+
+	Vec2 oldPlayerPosition = player->position;
+	if(input->moveRight)
+	{
+		player->position.x += PLAYER_SPEED * deltaTime;
+		if((player->position.x + player->size.x) >= GAME_WIDTH)
+		{
+			player->position.x = GAME_WIDTH - player->size.x;
+		}
+	}
+	if(input->moveLeft)
+	{
+		player->position.x -= PLAYER_SPEED * deltaTime;
+		if(player->position.x < 0)
+		{
+			player->position.x = 0;
+		}
+	}
+
+	MoveBall(game,ball,ballVelocity,deltaTime,player->position.x - oldPlayerPosition.x,game->bricks.aliveMask,false);
+
+	//The paddle itself can move into the ball, which the sweep of the ball doesn't see.
+	if(ballVelocity->y > 0 && AreColliding(player,ball))
+	{
+		ball->position.y = player->position.y - ball->size.y;
+		ballVelocity->y *= -1;
+		ballVelocity->x += (player->position.x - oldPlayerPosition.x) * 50;
+	}
+	if(ball->position.y >= GAME_HEIGHT)
+	{
+		game->state = GAME_STATE_LOST;
+	}
+	else if(GetAliveBrickCount(game) == 0)
+	{
+		game->state = GAME_STATE_WON;
+	}
+}
+
+bool IsBrickAlive(const Game* game,size_t index)
+{
+	return (game->bricks.aliveMask[index / 64] >> (index % 64)) & 1;
+}
+
+size_t GetAliveBrickCount(const Game* game)
+{
+	size_t count = 0;
+	for(size_t i = 0;i < (game->bricks.count + 63) / 64;++i)
+	{
+		count += CountBits(game->bricks.aliveMask[i]);
+	}
+	return count;
+}
+
+void StepGame(Game* game,const GameInput* input,float deltaTime)
+{
+	if(game->state == GAME_STATE_PLAY)
+	{
+		if(input->restart)
+		{
+			ResetGame(game);
+		}
+		StepPlay(game,input,deltaTime);
+	}
+	else if(input->start)
+	{
+		ResetGame(game);
+		game->state = GAME_STATE_PLAY;
+	}
+}
+
+void CreateBallStorm(BallStorm* storm,const Game* game,size_t count,uint32_t seed)
+{
+	uint32_t randomState = seed ? seed : 0x9E3779B9u;
+	storm->count = (count < BALL_STORM_CAPACITY) ? count : BALL_STORM_CAPACITY;
+	float bricksHeight = (float)game->brickRows * GetBrickSize(game).y;
+	uint32_t bricksBottom = (uint32_t)bricksHeight;
+	bricksBottom += (float)bricksBottom < bricksHeight;
+	//Balls start between the bricks and the paddle and move at 100 to 400 pixels per second along each axis.
+	for(size_t i = 0;i < storm->count;++i)
+	{
+		storm->positions[i] = (Vec2){
+			(float)(NextRandom(&randomState) % (GAME_WIDTH - BALL_WIDTH)),
+			(float)(bricksBottom + NextRandom(&randomState) % (GAME_HEIGHT - 48 - BALL_HEIGHT - bricksBottom))
+		};
+		uint32_t bits = NextRandom(&randomState);
+		storm->velocities[i] = (Vec2){
+			(float)(100 + bits % 301) * ((bits & 0x80000000u) ? -1.0f : 1.0f),
+			(float)(100 + (bits >> 10) % 301) * ((bits & 0x40000000u) ? -1.0f : 1.0f)
+		};
+		storm->previousPositions[i] = storm->positions[i];
+	}
+}
+
+void StepBallStorm(BallStorm* storm,const Game* game,float deltaTime)
+{
+	StepBallStormRange(storm,game,deltaTime,0,storm->count);
+}
+
+void StepBallStormRange(BallStorm* storm,const Game* game,float deltaTime,size_t begin,size_t end)
+{
+	if(begin >= end)
+	{
+		return;
+	}
+	//Bricks can only be hit above the lowest alive one; a ball whose swept box stays clear of them, the paddle and the walls just moves.
+	float bricksBottom = 0;
+	for(size_t i = 0;i < game->bricks.count;++i)
+	{
+		if(IsBrickAlive(game,i) && game->bricks.maxY[i] > bricksBottom)
+		{
+			bricksBottom = game->bricks.maxY[i];
+		}
+	}
+	const Box* player = &game->player;
+	memcpy(&storm->previousPositions[begin],&storm->positions[begin],(end - begin) * sizeof(*storm->positions));
+	for(size_t i = begin;i < end;++i)
+	{
+		Vec2* position = &storm->positions[i];
+		Vec2* velocity = &storm->velocities[i];
+		Vec2 newPosition = {position->x + velocity->x * deltaTime,position->y + velocity->y * deltaTime};
+		float minX = (position->x < newPosition.x) ? position->x : newPosition.x;
+		float minY = (position->y < newPosition.y) ? position->y : newPosition.y;
+		float maxX = ((position->x > newPosition.x) ? position->x : newPosition.x) + BALL_WIDTH;
+		float maxY = ((position->y > newPosition.y) ? position->y : newPosition.y) + BALL_HEIGHT;
+		//Bitwise operators instead of && and ||, because which test fails depends on where the ball is and would be mispredicted half of the time.
+		bool clearOfWalls = (minX > 0) & (maxX < GAME_WIDTH) & (minY > bricksBottom) & (maxY < GAME_HEIGHT);
+		bool clearOfPlayer = (maxX < player->position.x) | (minX > (player->position.x + player->size.x)) | (maxY < player->position.y) | (minY > (player->position.y + player->size.y));
+		if(clearOfWalls & clearOfPlayer)
+		{
+			*position = newPosition;
+			continue;
+		}
+		Box ball = {
+			.position = *position,
+			.size = {BALL_WIDTH,BALL_HEIGHT}
+		};
+		MoveBall(game,&ball,velocity,deltaTime,0,NULL,true);
+		*position = ball.position;
+	}
+}
\ No newline at end of file
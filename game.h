@@ -0,0 +1,110 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "math.h"
+
+#define GAME_WIDTH 1024
+#define GAME_HEIGHT 768
+#define PLAYER_WIDTH 128
+#define PLAYER_HEIGHT 16
+#define PLAYER_SPEED 300
+#define BALL_WIDTH 16
+#define BALL_HEIGHT 16
+//Levels are a grid of bricks spanning the width of the field; bricks are four times as wide as they are high.
+#define DEFAULT_BRICK_COLUMNS 8
+#define DEFAULT_BRICK_ROWS 5
+#define MAX_BRICK_COLUMNS 64
+//Bricks stay above this line, so they never cover the ball's starting position.
+#define BRICK_AREA_HEIGHT 320
+#define BRICK_VARIANT_COUNT 4
+#define MAX_BRICK_COUNT 4096
+//The grid is sized for every level so bricks fit in a cell, so every brick overlaps at most the cell of its top-left corner and the ones right and below it.
+#define MAX_BRICK_CELL_COUNT 4096
+//Room for 7 more bricks than can exist, so an 8-wide load starting at any brick stays inside the arrays; extra lanes are masked out.
+#define BRICK_CAPACITY (MAX_BRICK_COUNT + 7)
+#define BRICK_ALIVE_MASK_WORD_COUNT ((BRICK_CAPACITY + 63) / 64)
+#define BALL_STORM_CAPACITY 131072
+
+typedef enum GameState
+{
+	GAME_STATE_MAIN_MENU,
+	GAME_STATE_PLAY,
+	GAME_STATE_WON,
+	GAME_STATE_LOST,
+} GameState;
+
+typedef struct GameInput
+{
+	bool moveLeft;
+	bool moveRight;
+	bool start;
+	bool restart;
+} GameInput;
+
+typedef struct Box
+{
+	Vec2 position;
+	Vec2 size;
+} Box;
+
+//Structure of arrays, so collision tests load the bounds of several bricks at once.
+//Bricks are sorted by the grid cell of their top-left corner and cellBegin indexes the first brick of every cell,
+//so all bricks that can touch one row of cells are stored back to back.
+typedef struct Bricks
+{
+	float minX[BRICK_CAPACITY];
+	float minY[BRICK_CAPACITY];
+	float maxX[BRICK_CAPACITY];
+	float maxY[BRICK_CAPACITY];
+	uint8_t variants[BRICK_CAPACITY];
+	uint64_t aliveMask[BRICK_ALIVE_MASK_WORD_COUNT];
+	uint16_t cellBegin[MAX_BRICK_CELL_COUNT + 1];
+	float cellWidth;
+	float cellHeight;
+	uint32_t cellColumns;
+	uint32_t cellRows;
+	size_t count;
+} Bricks;
+
+//Everything the gameplay needs; it doesn't depend on SDL or the renderer, so it can be stepped without a window.
+typedef struct Game
+{
+	GameState state;
+	Box player;
+	Box ball;
+	Vec2 ballVelocity;
+	Bricks bricks;
+	uint32_t brickColumns;
+	uint32_t brickRows;
+	uint32_t randomState;
+	uint32_t roundIndex;
+} Game;
+
+//Extra balls for stress testing. They bounce off the walls, the floor, the paddle and the bricks without breaking them, so they never leave the playfield.
+//Kept out of Game, so copying the game every tick doesn't copy them; previousPositions holds the positions before the last step for interpolation.
+typedef struct BallStorm
+{
+	Vec2 positions[BALL_STORM_CAPACITY];
+	Vec2 previousPositions[BALL_STORM_CAPACITY];
+	Vec2 velocities[BALL_STORM_CAPACITY];
+	size_t count;
+} BallStorm;
+
+//The same seed always gives the same brick layouts. The level is clamped to MAX_BRICK_COLUMNS columns, MAX_BRICK_COUNT bricks
+//and as many rows as fit above BRICK_AREA_HEIGHT.
+void CreateGame(Game* game,uint32_t seed,uint32_t brickColumns,uint32_t brickRows);
+//Starts a new round and increments roundIndex, so callers can tell that positions jumped.
+void ResetGame(Game* game);
+void StepGame(Game* game,const GameInput* input,float deltaTime);
+bool IsBrickAlive(const Game* game,size_t index);
+size_t GetAliveBrickCount(const Game* game);
+//count is clamped to BALL_STORM_CAPACITY; the balls start below the game's bricks.
+void CreateBallStorm(BallStorm* storm,const Game* game,size_t count,uint32_t seed);
+void StepBallStorm(BallStorm* storm,const Game* game,float deltaTime);
+//Balls don't affect each other or the game, so disjoint ranges can be stepped on different threads at once.
+void StepBallStormRange(BallStorm* storm,const Game* game,float deltaTime,size_t begin,size_t end);
+
+#endif
\ No newline at end of file
@@ -1,283 +1,535 @@
+#include <SDL_log.h>
 #include <SDL_main.h>
+#include <SDL_timer.h>
 
 #include <time.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include "quit.h"
 #include "engine.h"
+#include "game.h"
 #include "renderer.h"
+#include "profiler.h"
 
-#define PLAYER_WIDTH 128
-#define PLAYER_HEIGHT 16
-#define BALL_WIDTH 16
-#define BALL_HEIGHT 16
-#define BRICK_WIDTH 128
-#define BRICK_HEIGHT 32
-#define BRICK_GRID_WIDTH 8
-#define BRICK_GRID_HEIGHT 5
+#define DEFAULT_HEADLESS_FRAME_COUNT 1000
+#define DEFAULT_TICK_RATE 120
+#define MAX_CATCH_UP_TICKS 8
+#define BALL_STORM_GRAIN_SIZE 4096
+#define DEFAULT_PROFILER_TRACE_PATH "profile.json"
+//Stays below the 4096 unfinished jobs a thread may have started.
+#define JOB_BENCHMARK_BATCH_SIZE 2048
+#define JOB_BENCHMARK_ROUND_COUNT 200
+//Bricks are static quads, which are drawn below all of these.
+#define RENDER_LAYER_BALLS 0
+#define RENDER_LAYER_PLAYER 1
+#define RENDER_LAYER_SCREENS 2
 
-typedef struct Brick
-{
-	QuadRenderCommand cmd;
-	bool destroyed;
-} Brick;
-
-static Brick* bricks;
-static size_t brickCapacity;
-static size_t brickCount;
-static QuadRenderCommand ballCmd;
-static Vec2 ballVelocity;
-static QuadRenderCommand playerCmd;
+static Game game;
+static Game previousGame;
+static BallStorm ballStorm;
 static Image titleImage = 0;
 static Image loseScreenImage = 0;
 static Image winScreenImage = 0;
 static Image ballImage = 0;
 static Image playerImage = 0;
-static Image brickImages[4] = {0};
+static Image brickImages[BRICK_VARIANT_COUNT] = {0};
+static StaticQuad brickQuads[MAX_BRICK_COUNT];
+static size_t brickQuadCount = 0;
+static uint64_t brickQuadAliveMask[BRICK_ALIVE_MASK_WORD_COUNT];
+static uint32_t brickQuadRoundIndex = 0;
 
 void TermGame(void)
 {
-	free(bricks);
 }
 
-static bool AreColliding(const QuadRenderCommand* a,const QuadRenderCommand* b)
+static void StepBallStormJob(void* userData,size_t begin,size_t end)
 {
-	return (a->position.x + a->size.x) >= b->position.x && a->position.x <= (b->position.x + b->size.x) && (a->position.y + a->size.y) >= b->position.y && a->position.y <= (b->position.y + b->size.y);
+	StepBallStormRange(&ballStorm,&game,*(const float*)userData,begin,end);
 }
 
-static void InitGame(void)
+static void EmptyJob(void* userData)
 {
-	ballCmd = (QuadRenderCommand){
-		.position = {512 - BALL_WIDTH / 2,386 - BALL_HEIGHT / 2},
-		.size = {BALL_WIDTH,BALL_HEIGHT},
-		.image = ballImage
-	};
-	ballVelocity = (Vec2){0,200};
+	(void)userData;
+}
 
-	playerCmd = (QuadRenderCommand){
-		.position = {512 - PLAYER_WIDTH / 2,768 - 48},
-		.size = {PLAYER_WIDTH,PLAYER_HEIGHT},
-		.image = playerImage
-	};
+static void EmptyRangeJob(void* userData,size_t begin,size_t end)
+{
+	(void)userData;
+	(void)begin;
+	(void)end;
+}
+
+static void SpawnEmptyJobs(void* userData)
+{
+	size_t count = *(const size_t*)userData;
+	JobCounter counter = {0};
+	for(size_t i = 0;i < count;++i)
+	{
+		RunJob(EmptyJob,NULL,&counter);
+	}
+	WaitForJobs(&counter);
+}
+
+static double GetMillisecondsSince(uint64_t startTimerValue)
+{
+	return (double)(SDL_GetPerformanceCounter() - startTimerValue) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
 
-	free(bricks);
-	brickCapacity = BRICK_GRID_WIDTH * BRICK_GRID_HEIGHT;
-	bricks = malloc(brickCapacity * sizeof(*bricks));
-	if(!bricks)
+//The jobs do nothing, so the time per job is only what scheduling, stealing and counting it costs.
+_Noreturn static void RunJobBenchmark(void)
+{
+	InitHeadlessEngine();
+	uint32_t threadCount = GetJobWorkerCount() + 1;
+	SDL_Log("Job benchmark with %u workers, %d rounds of %d jobs.",GetJobWorkerCount(),JOB_BENCHMARK_ROUND_COUNT,JOB_BENCHMARK_BATCH_SIZE);
+
+	uint64_t startTimerValue = SDL_GetPerformanceCounter();
+	for(int round = 0;round < JOB_BENCHMARK_ROUND_COUNT;++round)
 	{
-		AbortApplication("Coudln't allocate %zu bytes of memory.",brickCapacity * sizeof(*bricks));
+		JobCounter counter = {0};
+		for(int i = 0;i < JOB_BENCHMARK_BATCH_SIZE;++i)
+		{
+			RunJob(EmptyJob,NULL,&counter);
+		}
+		WaitForJobs(&counter);
 	}
+	double milliseconds = GetMillisecondsSince(startTimerValue);
+	SDL_Log("Jobs started by the main thread: %.1f ns per job.",milliseconds * 1e6 / (JOB_BENCHMARK_ROUND_COUNT * JOB_BENCHMARK_BATCH_SIZE));
 
-	brickCount = 0;
-	for(size_t y = 0;y < BRICK_GRID_HEIGHT;++y)
+	//Every thread gets one spawner, which starts the jobs in its own queue, so most of them run without being stolen.
+	size_t jobsPerSpawner = JOB_BENCHMARK_BATCH_SIZE / threadCount;
+	startTimerValue = SDL_GetPerformanceCounter();
+	for(int round = 0;round < JOB_BENCHMARK_ROUND_COUNT;++round)
 	{
-		for(size_t x = 0;x < BRICK_GRID_WIDTH;++x)
+		JobCounter counter = {0};
+		for(uint32_t i = 0;i < threadCount;++i)
 		{
-			bricks[y * BRICK_GRID_WIDTH + x] = (Brick){
-				.cmd = {
-					.size = {BRICK_WIDTH,BRICK_HEIGHT},
-					.position = {(float)x * BRICK_WIDTH,(float)y * BRICK_HEIGHT},
-					.image = brickImages[rand() % 4]
-				}
+			RunJob(SpawnEmptyJobs,&jobsPerSpawner,&counter);
+		}
+		WaitForJobs(&counter);
+	}
+	milliseconds = GetMillisecondsSince(startTimerValue);
+	SDL_Log("Jobs started by other jobs: %.1f ns per job.",milliseconds * 1e6 / (double)(JOB_BENCHMARK_ROUND_COUNT * threadCount * (jobsPerSpawner + 1)));
+
+	startTimerValue = SDL_GetPerformanceCounter();
+	for(int round = 0;round < JOB_BENCHMARK_ROUND_COUNT;++round)
+	{
+		JobCounter counter = {0};
+		ParallelFor(JOB_BENCHMARK_BATCH_SIZE,1,EmptyRangeJob,NULL,&counter);
+		WaitForJobs(&counter);
+	}
+	milliseconds = GetMillisecondsSince(startTimerValue);
+	SDL_Log("Parallel-for ranges: %.1f ns per job.",milliseconds * 1e6 / (JOB_BENCHMARK_ROUND_COUNT * JOB_BENCHMARK_BATCH_SIZE));
+
+	//Each job waits for the previous one through its counter, so nothing runs in parallel and this is the latency of a dependency.
+	static JobCounter chainCounters[JOB_BENCHMARK_BATCH_SIZE + 1];
+	startTimerValue = SDL_GetPerformanceCounter();
+	for(int round = 0;round < JOB_BENCHMARK_ROUND_COUNT;++round)
+	{
+		memset(chainCounters,0,sizeof(chainCounters));
+		for(int i = 1;i <= JOB_BENCHMARK_BATCH_SIZE;++i)
+		{
+			RunJobAfter(&chainCounters[i - 1],EmptyJob,NULL,&chainCounters[i]);
+		}
+		WaitForJobs(&chainCounters[JOB_BENCHMARK_BATCH_SIZE]);
+	}
+	milliseconds = GetMillisecondsSince(startTimerValue);
+	SDL_Log("Chained dependent jobs: %.1f ns per job.",milliseconds * 1e6 / (JOB_BENCHMARK_ROUND_COUNT * JOB_BENCHMARK_BATCH_SIZE));
+	ExitApplication();
+}
+
+//Bricks only change when a round starts or one of them breaks, so most frames draw them without touching the renderer.
+static void UpdateBrickQuads(void)
+{
+	const Bricks* bricks = &game.bricks;
+	if(brickQuadRoundIndex != game.roundIndex)
+	{
+		for(size_t i = 0;i < brickQuadCount;++i)
+		{
+			RemoveStaticQuad(brickQuads[i]);
+		}
+		for(size_t i = 0;i < bricks->count;++i)
+		{
+			QuadRenderCommand cmd = {
+				.position = {bricks->minX[i],bricks->minY[i]},
+				.size = {bricks->maxX[i] - bricks->minX[i],bricks->maxY[i] - bricks->minY[i]},
+				.image = brickImages[bricks->variants[i]]
 			};
-			++brickCount;
+			if(!AddStaticQuad(&cmd,&brickQuads[i]))
+			{
+				AbortApplication("%s",GetError());
+			}
 		}
+		brickQuadCount = bricks->count;
+		brickQuadRoundIndex = game.roundIndex;
+		//A bigger level may need more static quad slots than any round before.
+		RestartFrameArenaWarmUp();
+		//New quads are visible, so the loop below hides the bricks that aren't alive.
+		for(size_t i = 0;i < BRICK_ALIVE_MASK_WORD_COUNT;++i)
+		{
+			brickQuadAliveMask[i] = 0;
+		}
+		for(size_t i = 0;i < brickQuadCount;++i)
+		{
+			brickQuadAliveMask[i / 64] |= 1ull << (i % 64);
+		}
+	}
+	for(size_t i = 0;i < BRICK_ALIVE_MASK_WORD_COUNT;++i)
+	{
+		uint64_t changed = brickQuadAliveMask[i] ^ bricks->aliveMask[i];
+		for(size_t bit = 0;changed != 0;++bit,changed >>= 1)
+		{
+			if(changed & 1)
+			{
+				SetStaticQuadVisible(brickQuads[i * 64 + bit],(bricks->aliveMask[i] >> bit) & 1);
+			}
+		}
+		brickQuadAliveMask[i] = bricks->aliveMask[i];
+	}
+}
+
+//alpha is how far the display time got from previousGame towards game, in the range [0, 1).
+static void RenderGame(float alpha)
+{
+	//Interpolating across a new round would slide the ball and the paddle from where the last one ended.
+	if(previousGame.roundIndex != game.roundIndex)
+	{
+		alpha = 1.0f;
+	}
+	if(game.state == GAME_STATE_MAIN_MENU)
+	{
+		RenderQuad(&(QuadRenderCommand){
+			.position = {0,0},
+			.size = {GAME_WIDTH,GAME_HEIGHT},
+			.image = titleImage,
+			.layer = RENDER_LAYER_SCREENS
+		});
+		return;
+	}
+	RenderQuad(&(QuadRenderCommand){
+		.position = Vec2Lerp(previousGame.ball.position,game.ball.position,alpha),
+		.size = game.ball.size,
+		.image = ballImage,
+		.layer = RENDER_LAYER_BALLS
+	});
+	if(ballStorm.count > 0)
+	{
+		Vec2* ballStormRenderPositions = AllocateFrameMemory(ballStorm.count * sizeof(Vec2),_Alignof(Vec2));
+		if(!ballStormRenderPositions)
+		{
+			AbortApplication("%s",GetError());
+		}
+		//The storm only moves while a round is played, so its previous positions are stale otherwise.
+		for(size_t i = 0;i < ballStorm.count;++i)
+		{
+			ballStormRenderPositions[i] = (game.state == GAME_STATE_PLAY) ? Vec2Lerp(ballStorm.previousPositions[i],ballStorm.positions[i],alpha) : ballStorm.positions[i];
+		}
+		RenderQuadBatch(ballStormRenderPositions,ballStorm.count,(Vec2){BALL_WIDTH,BALL_HEIGHT},ballImage,RENDER_LAYER_BALLS);
+	}
+	RenderQuad(&(QuadRenderCommand){
+		.position = Vec2Lerp(previousGame.player.position,game.player.position,alpha),
+		.size = game.player.size,
+		.image = playerImage,
+		.layer = RENDER_LAYER_PLAYER
+	});
+	UpdateBrickQuads();
+	if(game.state == GAME_STATE_LOST)
+	{
+		RenderQuad(&(QuadRenderCommand){
+			.position = {0,0},
+			.size = {GAME_WIDTH,GAME_HEIGHT},
+			.image = loseScreenImage,
+			.layer = RENDER_LAYER_SCREENS
+		});
+	}
+	else if(game.state == GAME_STATE_WON)
+	{
+		RenderQuad(&(QuadRenderCommand){
+			.position = {0,0},
+			.size = {GAME_WIDTH,GAME_HEIGHT},
+			.image = winScreenImage,
+			.layer = RENDER_LAYER_SCREENS
+		});
 	}
 }
 
 int main(int argc,char** argv)
 {
-	(void)argc;
-	(void)argv;
+	uint32_t framesInFlight = 0;
+	bool headless = false;
+	uint32_t headlessFrameCount = DEFAULT_HEADLESS_FRAME_COUNT;
+	const char* capturePath = NULL;
+	uint32_t tickRate = DEFAULT_TICK_RATE;
+	size_t ballStormCount = 0;
+	uint32_t brickColumns = DEFAULT_BRICK_COLUMNS;
+	uint32_t brickRows = DEFAULT_BRICK_ROWS;
+	const char* profilerTracePath = NULL;
+	for(int i = 1;i < argc;++i)
+	{
+		if(strcmp(argv[i],"--frames-in-flight") == 0 && (i + 1) < argc)
+		{
+			framesInFlight = (uint32_t)strtoul(argv[++i],NULL,10);
+		}
+		else if(strcmp(argv[i],"--headless") == 0)
+		{
+			headless = true;
+		}
+		else if(strcmp(argv[i],"--frames") == 0 && (i + 1) < argc)
+		{
+			headlessFrameCount = (uint32_t)strtoul(argv[++i],NULL,10);
+			if(headlessFrameCount == 0)
+			{
+				headlessFrameCount = 1;
+			}
+		}
+		else if(strcmp(argv[i],"--capture") == 0 && (i + 1) < argc)
+		{
+			capturePath = argv[++i];
+		}
+		else if(strcmp(argv[i],"--tick-rate") == 0 && (i + 1) < argc)
+		{
+			tickRate = (uint32_t)strtoul(argv[++i],NULL,10);
+			if(tickRate == 0)
+			{
+				tickRate = DEFAULT_TICK_RATE;
+			}
+		}
+		else if(strcmp(argv[i],"--storm") == 0 && (i + 1) < argc)
+		{
+			ballStormCount = (size_t)strtoull(argv[++i],NULL,10);
+		}
+		else if(strcmp(argv[i],"--bricks") == 0 && (i + 1) < argc)
+		{
+			//Given as COLUMNSxROWS, e.g. 32x40.
+			char* end = NULL;
+			brickColumns = (uint32_t)strtoul(argv[++i],&end,10);
+			brickRows = (*end == 'x') ? (uint32_t)strtoul(end + 1,NULL,10) : DEFAULT_BRICK_ROWS;
+		}
+		else if(strcmp(argv[i],"--profile") == 0 && (i + 1) < argc)
+		{
+			profilerTracePath = argv[++i];
+		}
+		else if(strcmp(argv[i],"--job-benchmark") == 0)
+		{
+			RunJobBenchmark();
+		}
+	}
 
-	srand((unsigned)time(NULL));
-	InitEngine();
-	CreateMainWindow("CArkanoid",1024,768);
-	InitRenderer();
-	
-	if(!LoadTexture("assets/title.png",&titleImage))
+	//Headless runs render a fixed number of frames offscreen, e.g. on build machines with only a software Vulkan driver.
+	uint32_t seed = headless ? 1 : (uint32_t)time(NULL);
+	CreateGame(&game,seed,brickColumns,brickRows);
+	CreateBallStorm(&ballStorm,&game,ballStormCount,seed);
+	if(headless)
 	{
-		AbortApplication("%s",GetError());
+		InitHeadlessEngine();
+		CreateHeadlessContext(GAME_WIDTH,GAME_HEIGHT);
 	}
-	if(!LoadTexture("assets/lose.png",&loseScreenImage))
+	else
 	{
-		AbortApplication("%s",GetError());
+		InitEngine();
+		CreateMainWindow("CArkanoid",GAME_WIDTH,GAME_HEIGHT);
 	}
-	if(!LoadTexture("assets/win.png",&winScreenImage))
+	if(profilerTracePath && !SetProfilerExitTrace(profilerTracePath))
 	{
-		AbortApplication("%s",GetError());
+		SDL_Log("%s",GetError());
 	}
-	if(!LoadTexture("assets/ball.png",&ballImage))
+	InitRenderer();
+	if(framesInFlight > 0)
 	{
-		AbortApplication("%s",GetError());
+		SetFramesInFlight(framesInFlight);
 	}
-	if(!LoadTexture("assets/player.png",&playerImage))
+	
+	const char* texturePaths[] = {
+		"assets/title.png",
+		"assets/lose.png",
+		"assets/win.png",
+		"assets/ball.png",
+		"assets/player.png",
+		"assets/brick0.png",
+		"assets/brick1.png",
+		"assets/brick2.png",
+		"assets/brick3.png"
+	};
+	//The pack is produced at build time; without it the PNG files are decoded instead.
+	if(!LoadTexturePack("assets/textures.pack"))
 	{
-		AbortApplication("%s",GetError());
+		SDL_Log("Texture pack not used: %s",GetError());
 	}
-	if(!LoadTexture("assets/brick0.png",&brickImages[0]))
+	Image textures[sizeof(texturePaths) / sizeof(*texturePaths)] = {0};
+	if(!LoadTextures(texturePaths,sizeof(texturePaths) / sizeof(*texturePaths),textures))
 	{
 		AbortApplication("%s",GetError());
 	}
-	if(!LoadTexture("assets/brick1.png",&brickImages[1]))
+	UnloadTexturePack();
+	titleImage = textures[0];
+	loseScreenImage = textures[1];
+	winScreenImage = textures[2];
+	ballImage = textures[3];
+	playerImage = textures[4];
+	for(size_t i = 0;i < BRICK_VARIANT_COUNT;++i)
 	{
-		AbortApplication("%s",GetError());
+		brickImages[i] = textures[5 + i];
 	}
-	if(!LoadTexture("assets/brick2.png",&brickImages[2]))
+
+	uint32_t headlessFrameIndex = 0;
+	uint64_t headlessStartTimerValue = 0;
+	double minFrameMilliseconds = 0.0;
+	double maxFrameMilliseconds = 0.0;
+	if(headless)
 	{
-		AbortApplication("%s",GetError());
+		ResetGame(&game);
+		game.state = GAME_STATE_PLAY;
 	}
-	if(!LoadTexture("assets/brick3.png",&brickImages[3]))
+	previousGame = game;
+	GameState renderedState = game.state;
+#ifdef DEBUG_BUILD
+	if(headless && !TestFrameHeapAllocationCounter())
 	{
 		AbortApplication("%s",GetError());
 	}
-
-	typedef enum GameState
-	{
-		GAME_STATE_MAIN_MENU,
-		GAME_STATE_PLAY,
-		GAME_STATE_WON,
-		GAME_STATE_LOST,
-	} GameState;
-	GameState gameState = GAME_STATE_MAIN_MENU;
+#endif
+	//The simulation always advances in steps of tickDuration, no matter how long frames take, so results don't depend on the frame rate.
+	float tickDuration = 1.0f / (float)tickRate;
+	float accumulator = 0.0f;
 	
+#ifdef DEBUG_BUILD
+	float statisticsTimer = 0.0f;
+#endif
 	ResetTimer();
 	while(true)
 	{
+		uint64_t frameStartTimerValue = SDL_GetPerformanceCounter();
+		BeginProfilerZone("Frame");
+		BeginFrameArena();
+		if(headless && headlessFrameIndex == 0)
+		{
+			headlessStartTimerValue = frameStartTimerValue;
+		}
 		ProcessEvents();
-		float deltaTime = GetDeltaTime();
+		//A fixed step keeps headless runs reproducible, so captured frames can be compared between runs.
+		float deltaTime = headless ? (1.0f / 60.0f) : GetDeltaTime();
 		if(WasKeyPressed(SDL_SCANCODE_ESCAPE))
 		{
 			ExitApplication();
 		}
-
-		if(gameState == GAME_STATE_PLAY)
+		//Cycles between 1, 2 and 3 frames in flight, trading input latency for how much the CPU and GPU overlap.
+		if(WasKeyPressed(SDL_SCANCODE_F8))
 		{
-			if(IsKeyPressed(SDL_SCANCODE_R))
-			{
-				InitGame();
-			}
-
-			Vec2 oldPlayerPosition = playerCmd.position;
-			if(IsKeyPressed(SDL_SCANCODE_RIGHT))
-			{
-				playerCmd.position.x += 300 * deltaTime;
-				if((playerCmd.position.x + playerCmd.size.x) >= 1024)
-				{
-					playerCmd.position.x = 1024 - playerCmd.size.x;
-				}
-			}
-			if(IsKeyPressed(SDL_SCANCODE_LEFT))
-			{
-				playerCmd.position.x -= 300 * deltaTime;
-				if(playerCmd.position.x < 0)
-				{
-					playerCmd.position.x = 0;
-				}
-			}
-
-			ballCmd.position.x += ballVelocity.x * deltaTime;
-			ballCmd.position.y += ballVelocity.y * deltaTime;
-			if((ballCmd.position.x + ballCmd.size.x) >= 1024)
-			{
-				ballCmd.position.x = 1024 - ballCmd.size.x;
-				ballVelocity.x *= -1;
-			}
-			if(ballCmd.position.x < 0)
-			{
-				ballCmd.position.x = 0;
-				ballVelocity.x *= -1;
-			}
-			if(ballCmd.position.y < 0)
-			{
-				ballCmd.position.y = 0;
-				ballVelocity.y *= -1;
-			}
-			if(ballCmd.position.y >= 768)
+			SetFramesInFlight(GetFramesInFlight() % 3 + 1);
+			SDL_Log("Frames in flight: %u.",GetFramesInFlight());
+		}
+		if(WasKeyPressed(SDL_SCANCODE_F9))
+		{
+			const char* tracePath = profilerTracePath ? profilerTracePath : DEFAULT_PROFILER_TRACE_PATH;
+			if(WriteProfilerTrace(tracePath))
 			{
-				gameState = GAME_STATE_LOST;
+				SDL_Log("Wrote the profiler trace to \"%s\".",tracePath);
 			}
-
-			if(AreColliding(&playerCmd,&ballCmd))
+			else
 			{
-				ballCmd.position.y = playerCmd.position.y - ballCmd.size.y;
-				ballVelocity.y *= -1;
-				ballVelocity.x += (playerCmd.position.x - oldPlayerPosition.x) * 50;
+				SDL_Log("%s",GetError());
 			}
+		}
 
-			bool noBricksLeft = true;
-			for(size_t i = 0;i < brickCount;++i)
-			{
-				Brick* brick = &bricks[i];
-				if(!brick->destroyed)
-				{
-					noBricksLeft = false;
-					if(AreColliding(&brick->cmd,&ballCmd))
-					{
-						if(ballVelocity.x >= ballVelocity.y)
-						{
-							ballVelocity.x *= -1;
-						}
-						else
-						{
-							ballVelocity.y *= -1;
-						}
-						brick->destroyed = true;
-					}
-				}
-			}
-			if(noBricksLeft)
-			{
-				gameState = GAME_STATE_WON;
-			}
+		GameInput input = {
+			.moveLeft = IsKeyPressed(SDL_SCANCODE_LEFT),
+			.moveRight = IsKeyPressed(SDL_SCANCODE_RIGHT),
+			.start = IsKeyPressed(SDL_SCANCODE_RETURN),
+			.restart = IsKeyPressed(SDL_SCANCODE_R)
+		};
+		//After a long stall only a bounded amount of time is caught up, otherwise the simulation could never get ahead again.
+		accumulator += deltaTime;
+		if(accumulator > MAX_CATCH_UP_TICKS * tickDuration)
+		{
+			accumulator = MAX_CATCH_UP_TICKS * tickDuration;
 		}
-		else
+		BeginProfilerZone("Simulation");
+		while(accumulator >= tickDuration)
 		{
-			if(IsKeyPressed(SDL_SCANCODE_RETURN))
+			previousGame = game;
+			StepGame(&game,&input,tickDuration);
+			if(game.state == GAME_STATE_PLAY)
 			{
-				InitGame();
-				gameState = GAME_STATE_PLAY;
+				JobCounter ballStormCounter = {0};
+				ParallelFor(ballStorm.count,BALL_STORM_GRAIN_SIZE,StepBallStormJob,&tickDuration,&ballStormCounter);
+				WaitForJobs(&ballStormCounter);
 			}
+			accumulator -= tickDuration;
+		}
+		EndProfilerZone();
+		//E.g. the static bricks and the storm's render positions only appear once the game starts.
+		if(game.state != renderedState)
+		{
+			renderedState = game.state;
+			RestartFrameArenaWarmUp();
 		}
 
 		BeginRendering();
-		if(gameState == GAME_STATE_MAIN_MENU)
+		BeginProfilerZone("RenderGame");
+		RenderGame(accumulator / tickDuration);
+		EndProfilerZone();
+		if(headless && capturePath && (headlessFrameIndex + 1) == headlessFrameCount)
 		{
-			RenderQuad(&(QuadRenderCommand){
-				.position = {0,0},
-				.size = {1024,768},
-				.image = titleImage
-			});
+			RestartFrameArenaWarmUp();
+			if(!RequestFrameCapture(capturePath))
+			{
+				AbortApplication("%s",GetError());
+			}
 		}
-		else
+		EndRendering();
+		EndProfilerZone();
+
+		if(headless)
 		{
-			RenderQuad(&ballCmd);
-			RenderQuad(&playerCmd);
-			for(size_t i = 0;i < brickCount;++i)
+			uint64_t currentTimerValue = SDL_GetPerformanceCounter();
+			double frameMilliseconds = (double)(currentTimerValue - frameStartTimerValue) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+			if(headlessFrameIndex == 0 || frameMilliseconds < minFrameMilliseconds)
 			{
-				if(!bricks[i].destroyed)
-				{
-					RenderQuad(&bricks[i].cmd);
-				}
+				minFrameMilliseconds = frameMilliseconds;
 			}
-			if(gameState == GAME_STATE_LOST)
+			if(frameMilliseconds > maxFrameMilliseconds)
 			{
-				RenderQuad(&(QuadRenderCommand){
-					.position = {0,0},
-					.size = {1024,768},
-					.image = loseScreenImage
-				});
+				maxFrameMilliseconds = frameMilliseconds;
 			}
-			else if(gameState == GAME_STATE_WON)
+			if(++headlessFrameIndex >= headlessFrameCount)
 			{
-				RenderQuad(&(QuadRenderCommand){
-					.position = {0,0},
-					.size = {1024,768},
-					.image = winScreenImage
-				});
+				double totalMilliseconds = (double)(currentTimerValue - headlessStartTimerValue) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+				SDL_Log("Rendered %u frames in %.3f ms (%.3f ms average, %.3f ms min, %.3f ms max, %u frames in flight).",headlessFrameCount,totalMilliseconds,
+						totalMilliseconds / headlessFrameCount,minFrameMilliseconds,maxFrameMilliseconds,GetFramesInFlight());
+				GpuProfile gpuProfile = {0};
+				GetGpuProfile(&gpuProfile);
+				for(size_t i = 0;i < gpuProfile.timingCount;++i)
+				{
+					SDL_Log("GPU %*s%s: %.3f ms.",(int)(gpuProfile.timings[i].depth * 2),"",gpuProfile.timings[i].name,gpuProfile.timings[i].milliseconds);
+				}
+				SDL_Log("GPU texture uploads: %.3f ms in %u batches.",gpuProfile.uploadMilliseconds,gpuProfile.uploadBatchCount);
+				if(gpuProfile.hasPipelineStatistics)
+				{
+					SDL_Log("GPU pipeline statistics: %llu primitives, %llu vertex and %llu fragment shader invocations.",(unsigned long long)gpuProfile.inputAssemblyPrimitives,
+							(unsigned long long)gpuProfile.vertexShaderInvocations,(unsigned long long)gpuProfile.fragmentShaderInvocations);
+				}
+				ExitApplication();
 			}
 		}
-		EndRendering();
+
+#ifdef DEBUG_BUILD
+		statisticsTimer += deltaTime;
+		if(statisticsTimer >= 1.0f)
+		{
+			statisticsTimer = 0.0f;
+			RenderStatistics statistics = {0};
+			GetRenderStatistics(&statistics);
+			GpuProfile gpuProfile = {0};
+			GetGpuProfile(&gpuProfile);
+			//The first timing is the whole frame.
+			double gpuFrameMilliseconds = (gpuProfile.timingCount > 0) ? gpuProfile.timings[0].milliseconds : 0.0;
+			char title[320] = {0};
+			snprintf(title,sizeof(title),"CArkanoid (%.2f ms GPU, %.2f ms uploads, %zu draw calls, %zu/%zu runs unsorted/sorted, %zu instances, %zu allocations in %zu blocks, %.1f/%.1f MiB)",gpuFrameMilliseconds,gpuProfile.uploadMilliseconds,statistics.drawCallCount,statistics.unsortedRunCount,statistics.sortedRunCount,statistics.instanceCount,
+					 statistics.memoryAllocationCount,statistics.memoryBlockCount,(double)statistics.memoryUsedBytes / (1024.0 * 1024.0),(double)statistics.memoryReservedBytes / (1024.0 * 1024.0));
+			SetMainWindowTitle(title);
+		}
+#endif
 	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "mapped_file.h"
+
+#include "quit.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+bool MapFile(const char* filePath,MappedFile* outFile)
+{
+	*outFile = (MappedFile){0};
+	HANDLE fileHandle = CreateFileA(filePath,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(fileHandle == INVALID_HANDLE_VALUE)
+	{
+		SetError("Couldn't open file \"%s\" (error %lu).",filePath,GetLastError());
+		return false;
+	}
+	LARGE_INTEGER fileSize = {0};
+	if(!GetFileSizeEx(fileHandle,&fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(fileHandle);
+		SetError("Couldn't get the size of file \"%s\" or it is empty.",filePath);
+		return false;
+	}
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle,NULL,PAGE_READONLY,0,0,NULL);
+	if(!mappingHandle)
+	{
+		CloseHandle(fileHandle);
+		SetError("Couldn't create a mapping of file \"%s\" (error %lu).",filePath,GetLastError());
+		return false;
+	}
+	const void* data = MapViewOfFile(mappingHandle,FILE_MAP_READ,0,0,0);
+	if(!data)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		SetError("Couldn't map file \"%s\" (error %lu).",filePath,GetLastError());
+		return false;
+	}
+	*outFile = (MappedFile){
+		.data = data,
+		.size = (size_t)fileSize.QuadPart,
+		.fileHandle = fileHandle,
+		.mappingHandle = mappingHandle
+	};
+	return true;
+}
+
+void UnmapFile(MappedFile* file)
+{
+	if(file->data)
+	{
+		UnmapViewOfFile(file->data);
+		CloseHandle(file->mappingHandle);
+		CloseHandle(file->fileHandle);
+	}
+	*file = (MappedFile){0};
+}
+#else
+bool MapFile(const char* filePath,MappedFile* outFile)
+{
+	*outFile = (MappedFile){0};
+	int fileDescriptor = open(filePath,O_RDONLY);
+	if(fileDescriptor < 0)
+	{
+		SetError("Couldn't open file \"%s\".",filePath);
+		return false;
+	}
+	struct stat fileStatus = {0};
+	if(fstat(fileDescriptor,&fileStatus) != 0 || fileStatus.st_size == 0)
+	{
+		close(fileDescriptor);
+		SetError("Couldn't get the size of file \"%s\" or it is empty.",filePath);
+		return false;
+	}
+	void* data = mmap(NULL,(size_t)fileStatus.st_size,PROT_READ,MAP_PRIVATE,fileDescriptor,0);
+	//The mapping keeps its own reference to the file.
+	close(fileDescriptor);
+	if(data == MAP_FAILED)
+	{
+		SetError("Couldn't map file \"%s\".",filePath);
+		return false;
+	}
+	*outFile = (MappedFile){
+		.data = data,
+		.size = (size_t)fileStatus.st_size
+	};
+	return true;
+}
+
+void UnmapFile(MappedFile* file)
+{
+	if(file->data)
+	{
+		munmap((void*)file->data,file->size);
+	}
+	*file = (MappedFile){0};
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct MappedFile
+{
+	const void* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+} MappedFile;
+
+//Maps the whole file read-only.
+bool MapFile(const char* filePath,MappedFile* outFile);
+void UnmapFile(MappedFile* file);
+
+#endif
\ No newline at end of file
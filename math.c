@@ -42,4 +42,9 @@ Mat4 Mat4Mul(Mat4 a,Mat4 b)
 		}
 	}
 	return result;
+}
+
+Vec2 Vec2Lerp(Vec2 a,Vec2 b,float t)
+{
+	return (Vec2){a.x + (b.x - a.x) * t,a.y + (b.y - a.y) * t};
 }
\ No newline at end of file
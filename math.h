@@ -22,5 +22,6 @@ Mat4 Mat4Translate(Vec2 vec);
 Mat4 Mat4Scale(Vec2 vec);
 Mat4 Mat4Orthographic(float left,float right,float bottom,float top,float near,float far);
 Mat4 Mat4Mul(Mat4 a,Mat4 b);
+Vec2 Vec2Lerp(Vec2 a,Vec2 b,float t);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "quit.h"
+
+#ifdef PROFILER_ENABLED
+#define PROFILER_MAX_THREADS 128
+//Power of two; a thread that records more zones than this between two traces loses the oldest ones.
+#define PROFILER_ZONES_PER_THREAD 65536
+#define PROFILER_MAX_ZONE_DEPTH 32
+
+typedef struct ProfilerZone
+{
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+} ProfilerZone;
+
+//Only the owning thread writes into the ring; it publishes every finished zone by incrementing zoneCount afterwards.
+typedef struct ProfilerThread
+{
+	ProfilerZone zones[PROFILER_ZONES_PER_THREAD];
+	SDL_atomic_t zoneCount;
+	const char* name;
+	const char* openZoneNames[PROFILER_MAX_ZONE_DEPTH];
+	uint64_t openZoneBegins[PROFILER_MAX_ZONE_DEPTH];
+	uint32_t openZoneCount;
+	//Zones nested deeper than PROFILER_MAX_ZONE_DEPTH aren't recorded.
+	uint32_t untrackedZoneCount;
+} ProfilerThread;
+
+typedef struct Profiler
+{
+	void* threads[PROFILER_MAX_THREADS];
+	SDL_atomic_t threadCount;
+	SDL_TLSID threadKey;
+	uint64_t startTimerValue;
+	char* exitTracePath;
+} Profiler;
+
+static Profiler profiler;
+//Marks threads that came after all slots were taken, so they don't try to register again.
+static char unregisteredThread;
+
+//Threads register on their first zone; slots are never reused, so readers can walk them without a lock.
+static ProfilerThread* GetProfilerThread(void)
+{
+	if(!profiler.threadKey)
+	{
+		return NULL;
+	}
+	void* value = SDL_TLSGet(profiler.threadKey);
+	if(value)
+	{
+		return (value != &unregisteredThread) ? value : NULL;
+	}
+	int index = SDL_AtomicAdd(&profiler.threadCount,1);
+	ProfilerThread* thread = (index < PROFILER_MAX_THREADS) ? calloc(1,sizeof(*thread)) : NULL;
+	SDL_TLSSet(profiler.threadKey,thread ? (void*)thread : (void*)&unregisteredThread,NULL);
+	if(thread)
+	{
+		SDL_AtomicSetPtr(&profiler.threads[index],thread);
+	}
+	return thread;
+}
+
+void InitProfiler(void)
+{
+	profiler.threadKey = SDL_TLSCreate();
+	if(!profiler.threadKey)
+	{
+		AbortApplication("%s",SDL_GetError());
+	}
+	profiler.startTimerValue = SDL_GetPerformanceCounter();
+	SetProfilerThreadName("Main");
+}
+
+void TermProfiler(void)
+{
+	if(profiler.exitTracePath && !WriteProfilerTrace(profiler.exitTracePath))
+	{
+		SDL_Log("%s",GetError());
+	}
+	int threadCount = SDL_AtomicGet(&profiler.threadCount);
+	for(int i = 0;i < threadCount && i < PROFILER_MAX_THREADS;++i)
+	{
+		free(profiler.threads[i]);
+	}
+	free(profiler.exitTracePath);
+	profiler = (Profiler){0};
+}
+
+void SetProfilerThreadName(const char* name)
+{
+	ProfilerThread* thread = GetProfilerThread();
+	if(thread)
+	{
+		thread->name = name;
+	}
+}
+
+void BeginProfilerZone(const char* name)
+{
+	ProfilerThread* thread = GetProfilerThread();
+	if(!thread)
+	{
+		return;
+	}
+	if(thread->openZoneCount >= PROFILER_MAX_ZONE_DEPTH)
+	{
+		++thread->untrackedZoneCount;
+		return;
+	}
+	thread->openZoneNames[thread->openZoneCount] = name;
+	thread->openZoneBegins[thread->openZoneCount] = SDL_GetPerformanceCounter();
+	++thread->openZoneCount;
+}
+
+void EndProfilerZone(void)
+{
+	uint64_t timerValue = SDL_GetPerformanceCounter();
+	ProfilerThread* thread = GetProfilerThread();
+	if(!thread)
+	{
+		return;
+	}
+	if(thread->untrackedZoneCount > 0)
+	{
+		--thread->untrackedZoneCount;
+		return;
+	}
+	if(thread->openZoneCount == 0)
+	{
+		return;
+	}
+	--thread->openZoneCount;
+	unsigned zoneCount = (unsigned)SDL_AtomicGet(&thread->zoneCount);
+	thread->zones[zoneCount % PROFILER_ZONES_PER_THREAD] = (ProfilerZone){
+		.name = thread->openZoneNames[thread->openZoneCount],
+		.begin = thread->openZoneBegins[thread->openZoneCount],
+		.end = timerValue
+	};
+	SDL_AtomicAdd(&thread->zoneCount,1);
+}
+
+static void WriteJsonString(FILE* file,const char* string)
+{
+	fputc('"',file);
+	for(const char* c = string ? string : "";*c;++c)
+	{
+		if(*c == '"' || *c == '\\')
+		{
+			fputc('\\',file);
+		}
+		fputc(*c,file);
+	}
+	fputc('"',file);
+}
+
+bool WriteProfilerTrace(const char* filePath)
+{
+	ProfilerZone* zones = malloc(PROFILER_ZONES_PER_THREAD * sizeof(*zones));
+	if(!zones)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",PROFILER_ZONES_PER_THREAD * sizeof(*zones));
+		return false;
+	}
+	FILE* file = fopen(filePath,"wb");
+	if(!file)
+	{
+		free(zones);
+		SetError("Couldn't open \"%s\" for writing.",filePath);
+		return false;
+	}
+	double microsecondsPerTick = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n",file);
+	bool first = true;
+	int threadCount = SDL_AtomicGet(&profiler.threadCount);
+	for(int i = 0;i < threadCount && i < PROFILER_MAX_THREADS;++i)
+	{
+		ProfilerThread* thread = SDL_AtomicGetPtr(&profiler.threads[i]);
+		if(!thread)
+		{
+			continue;
+		}
+		if(thread->name)
+		{
+			fprintf(file,"%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",first ? "" : ",\n",i + 1);
+			WriteJsonString(file,thread->name);
+			fputs("}}",file);
+			first = false;
+		}
+		//Other threads keep recording while their zones are copied, so the zones they may have overwritten in the meantime are dropped afterwards.
+		unsigned endIndex = (unsigned)SDL_AtomicGet(&thread->zoneCount);
+		unsigned beginIndex = (endIndex > PROFILER_ZONES_PER_THREAD) ? (endIndex - PROFILER_ZONES_PER_THREAD) : 0;
+		for(unsigned j = beginIndex;j != endIndex;++j)
+		{
+			zones[j % PROFILER_ZONES_PER_THREAD] = thread->zones[j % PROFILER_ZONES_PER_THREAD];
+		}
+		//The zone after the last published one may be half-written too.
+		unsigned writtenEndIndex = (unsigned)SDL_AtomicGet(&thread->zoneCount) + 1;
+		if(writtenEndIndex > beginIndex + PROFILER_ZONES_PER_THREAD)
+		{
+			beginIndex = SDL_min(writtenEndIndex - PROFILER_ZONES_PER_THREAD,endIndex);
+		}
+		for(unsigned j = beginIndex;j != endIndex;++j)
+		{
+			const ProfilerZone* zone = &zones[j % PROFILER_ZONES_PER_THREAD];
+			fprintf(file,"%s{\"ph\":\"X\",\"name\":",first ? "" : ",\n");
+			WriteJsonString(file,zone->name);
+			fprintf(file,",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",i + 1,(double)(zone->begin - profiler.startTimerValue) * microsecondsPerTick,
+					(double)(zone->end - zone->begin) * microsecondsPerTick);
+			first = false;
+		}
+	}
+	fputs("\n]}\n",file);
+	free(zones);
+	if(fclose(file) != 0)
+	{
+		SetError("Couldn't write \"%s\".",filePath);
+		return false;
+	}
+	return true;
+}
+
+bool SetProfilerExitTrace(const char* filePath)
+{
+	size_t length = strlen(filePath);
+	char* path = malloc(length + 1);
+	if(!path)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",length + 1);
+		return false;
+	}
+	memcpy(path,filePath,length + 1);
+	free(profiler.exitTracePath);
+	profiler.exitTracePath = path;
+	return true;
+}
+#else
+bool WriteProfilerTrace(const char* filePath)
+{
+	(void)filePath;
+	SetError("The game was built without the profiler; configure it with -DCARKANOID_PROFILER=ON.");
+	return false;
+}
+
+bool SetProfilerExitTrace(const char* filePath)
+{
+	(void)filePath;
+	SetError("The game was built without the profiler; configure it with -DCARKANOID_PROFILER=ON.");
+	return false;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+//Zones are only recorded when the game is built with CARKANOID_PROFILER; otherwise the zone functions compile to nothing.
+#ifdef PROFILER_ENABLED
+//Called by the engine; the thread calling InitProfiler is named "Main" in the trace.
+void InitProfiler(void);
+void TermProfiler(void);
+//name has to stay valid until the profiler is terminated, e.g. a string literal.
+void SetProfilerThreadName(const char* name);
+//Zones nest and have to end on the thread that began them; the same lifetime rule as above applies to name.
+//Every thread records into its own buffer, which keeps only its most recent zones.
+void BeginProfilerZone(const char* name);
+void EndProfilerZone(void);
+#else
+#define InitProfiler() ((void)0)
+#define TermProfiler() ((void)0)
+#define SetProfilerThreadName(name) ((void)0)
+#define BeginProfilerZone(name) ((void)0)
+#define EndProfilerZone() ((void)0)
+#endif
+
+//Writes the recorded zones of all threads as Chrome trace JSON, which chrome://tracing and Perfetto can open.
+//Fails when the profiler isn't compiled in.
+bool WriteProfilerTrace(const char* filePath);
+//The trace is written to filePath once more when the engine terminates.
+bool SetProfilerExitTrace(const char* filePath);
+
+#endif
\ No newline at end of file
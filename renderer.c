@@ -1,23 +1,147 @@
 #include "renderer.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <SDL_image.h>
+#include <SDL_thread.h>
+#ifdef RUNTIME_SHADERS
 #include <shaderc/shaderc.h>
+#endif
 #include "vulkan.h"
 #include "engine.h"
 #include "vulkan_image.h"
 #include "vulkan_buffer.h"
+#include "vulkan_memory.h"
+#include "vulkan_upload.h"
+#include "vulkan_frame_ring.h"
+#include "mapped_file.h"
+#include "texture_pack.h"
+#include "vulkan_descriptor.h"
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_profiler.h"
+#include "profiler.h"
+
+#define MAX_TEXTURE_COUNT 4096
+#define INITIAL_TEXTURE_CAPACITY 64
+#define MAX_FRAMES_IN_FLIGHT 3
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+#define UPLOAD_STAGING_SIZE ((VkDeviceSize)32 * 1024 * 1024)
+#define FRAME_RING_PARTITION_SIZE ((VkDeviceSize)1024 * 1024)
+#define INITIAL_QUAD_INSTANCE_CAPACITY 256
+#define MAX_RECORDING_PARTITIONS 16
+//Below this many quads, copying and recording on one thread is cheaper than handing the work to other threads.
+#define PARALLEL_RECORDING_THRESHOLD 16384
+#define MIN_QUADS_PER_RECORDING_PARTITION 4096
+//Sort key layout, from the most significant bits: layer (8), blend mode (2), pipeline (6), texture (24), depth (24).
+//Blend mode and pipeline are 0 while there is a single alpha-blended pipeline; they sit above the texture so that they split draws as rarely as possible.
+#define SORT_KEY_LAYER_SHIFT 56
+#define SORT_KEY_TEXTURE_SHIFT 24
+#define SORT_KEY_DEPTH_MASK ((UINT64_C(1) << SORT_KEY_TEXTURE_SHIFT) - 1)
+//Depth is the submission index, which the stable sort preserves anyway, so the passes start above it.
+#define SORT_KEY_FIRST_SORTED_BYTE 3
+#define INITIAL_STATIC_QUAD_CAPACITY 64
+//More dirty runs than this are merged into the last copy region, together with the clean quads between them.
+#define MAX_STATIC_QUAD_COPY_REGIONS 32
+//Resizes beyond this many before the GPU catches up wait for it instead.
+#define MAX_RETIRED_SWAPCHAINS 4
+#define TEXTURE_DECODE_ERROR_SIZE 512
 
 typedef struct TransformationMatrix
 {
 	Mat4 matrix;
 } TransformationMatrix;
 
+typedef struct QuadInstance
+{
+	Vec2 position;
+	Vec2 size;
+	uint32_t image;
+} QuadInstance;
+
+//Everything the CPU touches while recording a frame, duplicated so that it can work on one frame while the GPU renders the others.
+typedef struct FrameData
+{
+	VkCommandPool commandPool;
+	VkCommandBuffer commandBuffer;
+	//One pool per recording partition, so threads recording at the same time never share a pool.
+	VkCommandPool secondaryCommandPools[MAX_RECORDING_PARTITIONS];
+	VkCommandBuffer secondaryCommandBuffers[MAX_RECORDING_PARTITIONS];
+	VkFence fence;
+	VkSemaphore imageAcquireSemaphore;
+	//Serial of the last frame submitted from this slot; zero when it was never submitted.
+	uint64_t submittedSerial;
+} FrameData;
+
+//A swapchain replaced on a resize, kept until the frames that were submitted while it was current are finished.
+typedef struct RetiredSwapchain
+{
+	VkSwapchainKHR swapchain;
+	uint32_t imageCount;
+	VkImageView* imageViews;
+	VkFramebuffer* framebuffers;
+	VkSemaphore* imageRenderSemaphores;
+	uint64_t lastFrameSerial;
+} RetiredSwapchain;
+
+//Pipelines are built on a separate thread so that the render loop never waits for the driver's shader compiler.
+typedef struct PipelineWorker
+{
+	SDL_Thread* thread;
+	SDL_mutex* mutex;
+	SDL_cond* condition;
+	VkRenderPass requestedRenderPass;
+	bool requested;
+	bool building;
+	bool quit;
+	VkPipeline builtPipeline;
+	VkRenderPass builtRenderPass;
+	VkResult buildResult;
+} PipelineWorker;
+
+typedef struct TextureDecodeBatch
+{
+	const char* const* filePaths;
+	size_t count;
+	SDL_Surface** surfaces;
+	bool* decoded;
+	//Every file gets its own message, since the workers decode them out of order.
+	char (*errorMessages)[TEXTURE_DECODE_ERROR_SIZE];
+	SDL_atomic_t cancelled;
+	SDL_mutex* mutex;
+	SDL_cond* condition;
+} TextureDecodeBatch;
+
+typedef struct QuadRecording
+{
+	FrameData* frame;
+	const QuadInstance* instances;
+	uint32_t partitionCount;
+	FrameAllocation instanceAllocation;
+	uint32_t matrixOffset;
+	VkResult results[MAX_RECORDING_PARTITIONS];
+	size_t drawCallCounts[MAX_RECORDING_PARTITIONS];
+} QuadRecording;
+
+typedef enum StaticQuadFlags
+{
+	STATIC_QUAD_USED = 1,
+	STATIC_QUAD_VISIBLE = 2,
+	STATIC_QUAD_DIRTY = 4
+} StaticQuadFlags;
+
+//What is currently bound in one command buffer, so that binds of unchanged state are skipped.
+typedef struct QuadBindState
+{
+	VkPipeline pipeline;
+	bool descriptorSetsBound;
+	size_t drawCallCount;
+} QuadBindState;
+
 typedef struct ImageData
 {
 	RenderingImage image;
-	VkDescriptorSet descriptorSet;
+	uint64_t uploadValue;
 } ImageData;
 
 typedef struct Renderer
@@ -26,37 +150,80 @@ typedef struct Renderer
 	uint32_t graphicsQueueFamilyIndex;
 	VkDevice device;
 	VkQueue graphicsQueue;
+	uint32_t transferQueueFamilyIndex;
+	VkQueue transferQueue;
+	MemoryAllocator memoryAllocator;
+	UploadQueue uploadQueue;
+	FrameRing frameRing;
+	VkDeviceSize minUniformBufferOffsetAlignment;
 	uint32_t swapchainImageCount;
 	VkExtent2D swapchainImageExtent;
 	VkSurfaceFormatKHR swapchainFormat;
 	VkSwapchainKHR swapchain;
 	VkImage* swapchainImages;
 	VkImageView* swapchainImageViews;
+	//Presenting waits on the semaphore of the presented image, since the presentation engine may hold it until that image is acquired again.
+	VkSemaphore* imageRenderSemaphores;
+	RetiredSwapchain retiredSwapchains[MAX_RETIRED_SWAPCHAINS];
+	uint32_t retiredSwapchainCount;
+	uint64_t frameSerial;
 	VkRenderPass renderPass;
+	VkFormat renderPassFormat;
 	VkFramebuffer* framebuffers;
-	VkCommandPool renderingCommandPool;
-	VkCommandBuffer renderingCommandBuffer;
-	VkSemaphore imageAcquireSemaphore;
-	VkSemaphore imageRenderSemaphore;
+	RenderingImage offscreenImages[MAX_FRAMES_IN_FLIGHT];
+	RenderingBuffer captureBuffer;
+	char* capturePath;
+	FrameData frames[MAX_FRAMES_IN_FLIGHT];
+	uint32_t recordingPartitionCount;
+	uint32_t framesInFlight;
+	uint32_t currentFrame;
 	uint32_t currentSwapchainIndex;
 	VkPipelineLayout pipelineLayout;
 	VkPipeline pipeline;
+	VkPipelineCache pipelineCache;
+	char* pipelineCachePath;
+	PipelineWorker pipelineWorker;
 	VkShaderModule vertexShaderModule;
 	VkShaderModule fragmentShaderModule;
+#ifdef RUNTIME_SHADERS
 	shaderc_compiler_t shaderCompiler;
+#endif
 	RenderingBuffer quadBuffer;
-	RenderingBuffer transformationMatrixBuffer;
 	VkDescriptorSetLayout descriptorSetLayout;
-	VkDescriptorPool descriptorPool;
+	DescriptorAllocator descriptorAllocator;
 	VkDescriptorSet transformationMatrixDescriptorSet;
-	VkDescriptorSetLayout materialDescriptorSetLayout;
+	VkDescriptorSetLayout textureDescriptorSetLayout;
+	VkDescriptorSet textureDescriptorSet;
+	VkDescriptorPool textureDescriptorPool;
+	uint32_t textureCapacity;
+	uint32_t maxTextureCount;
 	VkSampler sampler;
 	ImageData* images;
 	size_t imageCount;
-	QuadRenderCommand* quadRenderCommands;
-	size_t quadRenderCommandCapacity;
-	size_t quadRenderCommandCount;
+	MappedFile texturePack;
+	const TexturePackEntry* texturePackEntries;
+	uint32_t texturePackEntryCount;
+	//The queue lives in the frame arena and starts out empty every frame.
+	QuadInstance* quadInstances;
+	uint64_t* quadSortKeys;
+	size_t quadInstanceCount;
+	size_t quadInstanceCapacity;
+	//Slots below staticQuadCount are drawn every frame; unused and hidden slots hold zero-sized instances on the GPU.
+	RenderingBuffer staticQuadBuffer;
+	size_t staticQuadBufferCapacity;
+	QuadInstance* staticQuads;
+	uint8_t* staticQuadFlags;
+	StaticQuad* freeStaticQuads;
+	size_t freeStaticQuadCount;
+	size_t staticQuadCount;
+	size_t staticQuadCapacity;
+	size_t staticQuadDirtyBegin;
+	size_t staticQuadDirtyEnd;
+	RenderStatistics statistics;
+	GpuProfiler gpuProfiler;
+	GpuProfiler uploadProfiler;
 	bool noSwapchain;
+	bool headless;
 } Renderer;
 
 extern VkInstance vkInstance;
@@ -102,8 +269,11 @@ static void CreateDevice(void)
 	{
 		if(queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
 		{
-			VkBool32 surfaceSupported = VK_FALSE;
-			VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(renderer.physicalDevice,i,vkSurface,&surfaceSupported));
+			VkBool32 surfaceSupported = renderer.headless;
+			if(!renderer.headless)
+			{
+				VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(renderer.physicalDevice,i,vkSurface,&surfaceSupported));
+			}
 			if(surfaceSupported)
 			{
 				renderer.graphicsQueueFamilyIndex = i;
@@ -111,31 +281,130 @@ static void CreateDevice(void)
 			}
 		}
 	}
+	//A transfer-only family usually maps to the DMA engines, which copy without taking time away from rendering.
+	renderer.transferQueueFamilyIndex = renderer.graphicsQueueFamilyIndex;
+	for(uint32_t i = 0;i < queueFamilyPropertyCount;++i)
+	{
+		VkQueueFlags queueFlags = queueFamilyProperties[i].queueFlags;
+		if((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			renderer.transferQueueFamilyIndex = i;
+			break;
+		}
+	}
 	free(queueFamilyProperties);
 	if(renderer.graphicsQueueFamilyIndex == UINT32_MAX)
 	{
 		AbortApplication("Couldn't find quaue family that supportes both graphics rendering and current surface.");
 	}
 
-	VkDeviceQueueCreateInfo deviceQueueCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = renderer.graphicsQueueFamilyIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &(float){1.0f}
+	VkPhysicalDeviceProperties physicalDeviceProperties = {0};
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice,&physicalDeviceProperties);
+	if(physicalDeviceProperties.apiVersion < VK_API_VERSION_1_2)
+	{
+		AbortApplication("Device \"%s\" doesn't support Vulkan 1.2.",physicalDeviceProperties.deviceName);
+	}
+
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+	};
+	VkPhysicalDeviceFeatures2 supportedFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supportedVulkan12Features
+	};
+	vkGetPhysicalDeviceFeatures2(renderer.physicalDevice,&supportedFeatures);
+	if(!supportedVulkan12Features.runtimeDescriptorArray || !supportedVulkan12Features.descriptorBindingPartiallyBound ||
+	   !supportedVulkan12Features.descriptorBindingVariableDescriptorCount || !supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind ||
+	   !supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending || !supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing)
+	{
+		AbortApplication("Device \"%s\" doesn't support descriptor indexing features required for bindless textures.",physicalDeviceProperties.deviceName);
+	}
+	if(!supportedVulkan12Features.timelineSemaphore)
+	{
+		AbortApplication("Device \"%s\" doesn't support timeline semaphores.",physicalDeviceProperties.deviceName);
+	}
+
+	VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES
+	};
+	vkGetPhysicalDeviceProperties2(renderer.physicalDevice,&(VkPhysicalDeviceProperties2){
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &descriptorIndexingProperties
+	});
+	renderer.minUniformBufferOffsetAlignment = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+	renderer.maxTextureCount = MAX_TEXTURE_COUNT;
+	if(renderer.maxTextureCount > descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages)
+	{
+		renderer.maxTextureCount = descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages;
+	}
+	if(renderer.maxTextureCount > descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages)
+	{
+		renderer.maxTextureCount = descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages;
+	}
+
+	VkDeviceQueueCreateInfo deviceQueueCreateInfos[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = renderer.graphicsQueueFamilyIndex,
+			.queueCount = 1,
+			.pQueuePriorities = &(float){1.0f}
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = renderer.transferQueueFamilyIndex,
+			.queueCount = 1,
+			.pQueuePriorities = &(float){1.0f}
+		}
 	};
 	VkDeviceCreateInfo deviceCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		.pEnabledFeatures = &(VkPhysicalDeviceFeatures){0},
-		.queueCreateInfoCount = 1,
-		.pQueueCreateInfos = &deviceQueueCreateInfo,
-		.enabledExtensionCount = 1,
+		.pNext = &(VkPhysicalDeviceVulkan12Features){
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+			.runtimeDescriptorArray = VK_TRUE,
+			.descriptorBindingPartiallyBound = VK_TRUE,
+			.descriptorBindingVariableDescriptorCount = VK_TRUE,
+			.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+			.descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+			.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+			.timelineSemaphore = VK_TRUE,
+			.hostQueryReset = supportedVulkan12Features.hostQueryReset
+		},
+		//Profiling features are optional; statistics queries stay active while secondary command buffers execute, so they need both.
+		.pEnabledFeatures = &(VkPhysicalDeviceFeatures){
+			.pipelineStatisticsQuery = supportedFeatures.features.pipelineStatisticsQuery && supportedFeatures.features.inheritedQueries,
+			.inheritedQueries = supportedFeatures.features.pipelineStatisticsQuery && supportedFeatures.features.inheritedQueries
+		},
+		.queueCreateInfoCount = (renderer.transferQueueFamilyIndex != renderer.graphicsQueueFamilyIndex) ? 2 : 1,
+		.pQueueCreateInfos = deviceQueueCreateInfos,
+		.enabledExtensionCount = renderer.headless ? 0 : 1,
 		.ppEnabledExtensionNames = &(const char*){VK_KHR_SWAPCHAIN_EXTENSION_NAME}
 	};
 	VK_CHECK(vkCreateDevice(renderer.physicalDevice,&deviceCreateInfo,NULL,&renderer.device));
 	vkGetDeviceQueue(renderer.device,renderer.graphicsQueueFamilyIndex,0,&renderer.graphicsQueue);
+	vkGetDeviceQueue(renderer.device,renderer.transferQueueFamilyIndex,0,&renderer.transferQueue);
+	if(!CreateMemoryAllocator(renderer.device,renderer.physicalDevice,&renderer.memoryAllocator))
+	{
+		AbortApplication(GetError());
+	}
+	if(!CreateUploadQueue(renderer.device,&renderer.memoryAllocator,renderer.transferQueue,renderer.transferQueueFamilyIndex,UPLOAD_STAGING_SIZE,&renderer.uploadQueue))
+	{
+		AbortApplication(GetError());
+	}
+	if(!CreateGpuProfiler(renderer.device,renderer.physicalDevice,renderer.graphicsQueueFamilyIndex,MAX_FRAMES_IN_FLIGHT,
+						  supportedFeatures.features.pipelineStatisticsQuery && supportedFeatures.features.inheritedQueries,supportedVulkan12Features.hostQueryReset,&renderer.gpuProfiler) ||
+	   !CreateGpuProfiler(renderer.device,renderer.physicalDevice,renderer.transferQueueFamilyIndex,UPLOAD_BATCH_COUNT,false,supportedVulkan12Features.hostQueryReset,&renderer.uploadProfiler))
+	{
+		AbortApplication(GetError());
+	}
+	renderer.uploadQueue.profiler = &renderer.uploadProfiler;
+	if(!CreateFrameRing(renderer.device,&renderer.memoryAllocator,FRAME_RING_PARTITION_SIZE,MAX_FRAMES_IN_FLIGHT,VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,&renderer.frameRing))
+	{
+		AbortApplication(GetError());
+	}
 }
 
-static void CreateSwapchain(void)
+//The old swapchain, if any, is passed on so the driver can reuse its resources; it's retired either way.
+static void CreateSwapchain(VkSwapchainKHR oldSwapchain)
 {
 	uint32_t surfaceFormatCount = 0;
 	VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(renderer.physicalDevice,vkSurface,&surfaceFormatCount,NULL));
@@ -161,6 +430,7 @@ static void CreateSwapchain(void)
 	if(surfaceCapabilities.currentExtent.width == 0 || surfaceCapabilities.currentExtent.height == 0)
 	{
 		renderer.noSwapchain = true;
+		renderer.swapchainImageCount = 0;
 		return;
 	}
 
@@ -179,7 +449,8 @@ static void CreateSwapchain(void)
 		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		.presentMode = VK_PRESENT_MODE_FIFO_KHR,
 		.preTransform = surfaceCapabilities.currentTransform,
-		.minImageCount = renderer.swapchainImageCount
+		.minImageCount = renderer.swapchainImageCount,
+		.oldSwapchain = oldSwapchain
 	};
 	VK_CHECK(vkCreateSwapchainKHR(renderer.device,&swapchainCreateInfo,NULL,&renderer.swapchain));
 
@@ -193,10 +464,18 @@ static void CreateSwapchain(void)
 	renderer.swapchainImageViews = calloc(renderer.swapchainImageCount,sizeof(*renderer.swapchainImageViews));
 	if(!renderer.swapchainImageViews)
 	{
-		AbortApplication("Couldn't allocate %zu bytes of memory.",renderer.swapchainImageCount,sizeof(*renderer.swapchainImageViews));
+		AbortApplication("Couldn't allocate %zu bytes of memory.",renderer.swapchainImageCount * sizeof(*renderer.swapchainImageViews));
+	}
+	renderer.imageRenderSemaphores = calloc(renderer.swapchainImageCount,sizeof(*renderer.imageRenderSemaphores));
+	if(!renderer.imageRenderSemaphores)
+	{
+		AbortApplication("Couldn't allocate %zu bytes of memory.",renderer.swapchainImageCount * sizeof(*renderer.imageRenderSemaphores));
 	}
 	for(uint32_t i = 0;i < renderer.swapchainImageCount;++i)
 	{
+		VK_CHECK(vkCreateSemaphore(renderer.device,&(VkSemaphoreCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+		},NULL,&renderer.imageRenderSemaphores[i]));
 		VkImageViewCreateInfo imageViewCreateInfo = {
 			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
 			.image = renderer.swapchainImages[i],
@@ -218,13 +497,44 @@ static void CreateSwapchain(void)
 	}
 }
 
+//Stands in for the swapchain when there is no window; there is one image per frame in flight, so an image is free again once its frame's fence is signaled.
+static void CreateOffscreenTargets(void)
+{
+	GetMainWindowSize(&renderer.swapchainImageExtent.width,&renderer.swapchainImageExtent.height);
+	renderer.swapchainFormat = (VkSurfaceFormatKHR){
+		.format = VK_FORMAT_R8G8B8A8_UNORM,
+		.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
+	};
+	renderer.swapchainImageCount = MAX_FRAMES_IN_FLIGHT;
+	renderer.noSwapchain = false;
+	renderer.swapchainImages = malloc(renderer.swapchainImageCount * sizeof(*renderer.swapchainImages));
+	if(!renderer.swapchainImages)
+	{
+		AbortApplication("Couldn't allocate %zu bytes of memory.",renderer.swapchainImageCount * sizeof(*renderer.swapchainImages));
+	}
+	renderer.swapchainImageViews = calloc(renderer.swapchainImageCount,sizeof(*renderer.swapchainImageViews));
+	if(!renderer.swapchainImageViews)
+	{
+		AbortApplication("Couldn't allocate %zu bytes of memory.",renderer.swapchainImageCount * sizeof(*renderer.swapchainImageViews));
+	}
+	for(uint32_t i = 0;i < renderer.swapchainImageCount;++i)
+	{
+		if(!CreateRenderingImage(renderer.device,&renderer.memoryAllocator,renderer.swapchainImageExtent,VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,1,&renderer.graphicsQueueFamilyIndex,&renderer.offscreenImages[i]))
+		{
+			AbortApplication(GetError());
+		}
+		renderer.swapchainImages[i] = renderer.offscreenImages[i].image;
+		renderer.swapchainImageViews[i] = renderer.offscreenImages[i].imageView;
+	}
+}
+
 static void CreateRenderPass(void)
 {
 	VkAttachmentDescription attachmentDescription = {
 		.samples = VK_SAMPLE_COUNT_1_BIT,
 		.format = renderer.swapchainFormat.format,
 		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		.finalLayout = renderer.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
 		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
 		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
@@ -240,12 +550,23 @@ static void CreateRenderPass(void)
 		.pResolveAttachments = NULL
 	};
 
+	//Offscreen images may be copied to the capture buffer right after the render pass.
+	VkSubpassDependency captureDependency = {
+		.srcSubpass = 0,
+		.dstSubpass = VK_SUBPASS_EXTERNAL,
+		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+		.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
+	};
 	VkRenderPassCreateInfo renderPassCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 		.attachmentCount = 1,
 		.pAttachments = &attachmentDescription,
 		.subpassCount = 1,
-		.pSubpasses = &subpassDescription
+		.pSubpasses = &subpassDescription,
+		.dependencyCount = renderer.headless ? 1 : 0,
+		.pDependencies = &captureDependency
 	};
 	VK_CHECK(vkCreateRenderPass(renderer.device,&renderPassCreateInfo,NULL,&renderer.renderPass));
 }
@@ -272,205 +593,711 @@ static void CreateFramebuffers(void)
 	}
 }
 
-static void CreateRenderingCommandPoolAndBuffer(void)
+static void CreateCommandPools(void)
 {
-	VkCommandPoolCreateInfo commandPoolCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-		.queueFamilyIndex = renderer.graphicsQueueFamilyIndex
-	};
-	VK_CHECK(vkCreateCommandPool(renderer.device,&commandPoolCreateInfo,NULL,&renderer.renderingCommandPool));
+	//Every thread that can run jobs gets a partition of the quads when there are enough of them.
+	renderer.recordingPartitionCount = GetJobWorkerCount() + 1;
+	if(renderer.recordingPartitionCount > MAX_RECORDING_PARTITIONS)
+	{
+		renderer.recordingPartitionCount = MAX_RECORDING_PARTITIONS;
+	}
+	//Each frame has its own pool, which is reset as a whole once the frame's fence is signaled.
+	for(uint32_t i = 0;i < MAX_FRAMES_IN_FLIGHT;++i)
+	{
+		VkCommandPoolCreateInfo commandPoolCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = renderer.graphicsQueueFamilyIndex
+		};
+		VK_CHECK(vkCreateCommandPool(renderer.device,&commandPoolCreateInfo,NULL,&renderer.frames[i].commandPool));
 
-	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = renderer.renderingCommandPool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 1,
-	};
-	VK_CHECK(vkAllocateCommandBuffers(renderer.device,&commandBufferAllocateInfo,&renderer.renderingCommandBuffer));
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = renderer.frames[i].commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+		VK_CHECK(vkAllocateCommandBuffers(renderer.device,&commandBufferAllocateInfo,&renderer.frames[i].commandBuffer));
+
+		for(uint32_t j = 0;j < renderer.recordingPartitionCount && renderer.recordingPartitionCount > 1;++j)
+		{
+			VK_CHECK(vkCreateCommandPool(renderer.device,&commandPoolCreateInfo,NULL,&renderer.frames[i].secondaryCommandPools[j]));
+			commandBufferAllocateInfo.commandPool = renderer.frames[i].secondaryCommandPools[j];
+			commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			VK_CHECK(vkAllocateCommandBuffers(renderer.device,&commandBufferAllocateInfo,&renderer.frames[i].secondaryCommandBuffers[j]));
+		}
+	}
 }
 
-static void CreateSemaphores(void)
+static void CreateSynchronizationObjects(void)
 {
 	VkSemaphoreCreateInfo semaphoreCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
 	};
-	VK_CHECK(vkCreateSemaphore(renderer.device,&semaphoreCreateInfo,NULL,&renderer.imageAcquireSemaphore));
-	VK_CHECK(vkCreateSemaphore(renderer.device,&semaphoreCreateInfo,NULL,&renderer.imageRenderSemaphore));
+	VkFenceCreateInfo fenceCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		.flags = VK_FENCE_CREATE_SIGNALED_BIT
+	};
+	for(uint32_t i = 0;i < MAX_FRAMES_IN_FLIGHT;++i)
+	{
+		VK_CHECK(vkCreateSemaphore(renderer.device,&semaphoreCreateInfo,NULL,&renderer.frames[i].imageAcquireSemaphore));
+		VK_CHECK(vkCreateFence(renderer.device,&fenceCreateInfo,NULL,&renderer.frames[i].fence));
+	}
 }
 
-static void RecordCommandBuffer(void)
+static void WriteFrameRingDescriptor(void)
 {
-	VkCommandBufferBeginInfo commandBufferBeginInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
-	};
-	VK_CHECK(vkBeginCommandBuffer(renderer.renderingCommandBuffer,&commandBufferBeginInfo));
-
-	VkRenderPassBeginInfo renderPassBeginInfo = {
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		.framebuffer = renderer.framebuffers[renderer.currentSwapchainIndex],
-		.renderPass = renderer.renderPass,
-		.renderArea = {
-			.offset = {0,0},
-			.extent = renderer.swapchainImageExtent
-		},
-		.clearValueCount = 1,
-		.pClearValues = &(VkClearValue){
-			.color = {
-				.float32 = {0.0f,0.0f,0.0f,1.0f}
-			}
+	vkUpdateDescriptorSets(renderer.device,1,&(VkWriteDescriptorSet){
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.dstArrayElement = 0,
+		.dstBinding = 0,
+		.dstSet = renderer.transformationMatrixDescriptorSet,
+		.pBufferInfo = &(VkDescriptorBufferInfo){
+			.buffer = renderer.frameRing.buffer.buffer,
+			.offset = 0,
+			.range = sizeof(TransformationMatrix)
 		}
-	};
+	},0,NULL);
+}
 
-	vkCmdUpdateBuffer(renderer.renderingCommandBuffer,renderer.transformationMatrixBuffer.buffer,0,sizeof(TransformationMatrix),&(TransformationMatrix){
-		.matrix = Mat4Orthographic(0,(float)renderer.swapchainImageExtent.width,0,(float)renderer.swapchainImageExtent.height,-1,1)
-	});
-	vkCmdBeginRenderPass(renderer.renderingCommandBuffer,&renderPassBeginInfo,VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(renderer.renderingCommandBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,renderer.pipeline);
+//Called before anything else allocates from the current partition, because growing the ring throws away its contents.
+static void ReserveFrameData(VkDeviceSize size)
+{
+	if(size <= renderer.frameRing.partitionSize)
+	{
+		return;
+	}
+	//Other partitions and the descriptor set may still be in use; this only happens when the scene gets bigger than ever before.
+	VK_CHECK(vkQueueWaitIdle(renderer.graphicsQueue));
+	if(!GrowFrameRing(&renderer.frameRing,size))
+	{
+		AbortApplication(GetError());
+	}
+	CountFrameHeapAllocation();
+	WriteFrameRingDescriptor();
+	SDL_Log("Frame ring partitions grew to %llu bytes.",(unsigned long long)renderer.frameRing.partitionSize);
+}
 
-	vkCmdBindVertexBuffers(renderer.renderingCommandBuffer,0,1,&renderer.quadBuffer.buffer,&(VkDeviceSize){0});
+static void RecordFrameCapture(FrameData* frame)
+{
+	if(!renderer.capturePath)
+	{
+		return;
+	}
+	BeginGpuScope(&renderer.gpuProfiler,frame->commandBuffer,"Frame capture");
+	vkCmdCopyImageToBuffer(frame->commandBuffer,renderer.swapchainImages[renderer.currentSwapchainIndex],VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,renderer.captureBuffer.buffer,1,&(VkBufferImageCopy){
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.layerCount = 1
+		},
+		.imageExtent = {renderer.swapchainImageExtent.width,renderer.swapchainImageExtent.height,1}
+	});
+	//Makes the copy visible to the host once the frame's fence is signaled.
+	vkCmdPipelineBarrier(frame->commandBuffer,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_HOST_BIT,0,1,&(VkMemoryBarrier){
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT
+	},0,NULL,0,NULL);
+	EndGpuScope(&renderer.gpuProfiler,frame->commandBuffer);
+}
 
-	vkCmdBindDescriptorSets(renderer.renderingCommandBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,renderer.pipelineLayout,0,1,&renderer.transformationMatrixDescriptorSet,0,NULL);
-	for(size_t i = 0;i < renderer.quadRenderCommandCount;++i)
+//On failure the arrays that were already resized stay valid, they are just bigger than needed.
+static bool ResizeArrays(void** const* arrays,const size_t* elementSizes,size_t arrayCount,size_t capacity)
+{
+	for(size_t i = 0;i < arrayCount;++i)
 	{
-		QuadRenderCommand* cmd = &renderer.quadRenderCommands[i];
-		ImageData* image = &renderer.images[cmd->image];
-		vkCmdBindDescriptorSets(renderer.renderingCommandBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,renderer.pipelineLayout,1,1,&image->descriptorSet,0,NULL);
-		vkCmdPushConstants(renderer.renderingCommandBuffer,renderer.pipelineLayout,VK_SHADER_STAGE_VERTEX_BIT,0,sizeof(TransformationMatrix),&(TransformationMatrix){
-			.matrix = Mat4Mul(Mat4Translate(cmd->position),Mat4Scale(cmd->size))
-		});
-		vkCmdDraw(renderer.renderingCommandBuffer,(uint32_t)(renderer.quadBuffer.size / sizeof(Vertex)),1,0,0);
+		void* tmp = realloc(*arrays[i],capacity * elementSizes[i]);
+		if(!tmp)
+		{
+			SetError("Couldn't allocate %zu bytes of memory.",capacity * elementSizes[i]);
+			return false;
+		}
+		*arrays[i] = tmp;
+		CountFrameHeapAllocation();
 	}
-	vkCmdEndRenderPass(renderer.renderingCommandBuffer);
+	return true;
+}
 
-	VK_CHECK(vkEndCommandBuffer(renderer.renderingCommandBuffer));
+//Blend mode, pipeline and texture without the layer and depth.
+static uint32_t GetSortKeyState(uint64_t sortKey)
+{
+	return (uint32_t)(sortKey >> SORT_KEY_TEXTURE_SHIFT);
 }
 
-static void CreatePipelineLayout(void)
+//Counts the runs of neighbouring keys that share their state.
+static size_t CountQuadRuns(const uint64_t* keys,size_t count)
 {
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = 2,
-		.pSetLayouts = (VkDescriptorSetLayout[]){
-			renderer.descriptorSetLayout,
-			renderer.materialDescriptorSetLayout
-		},
-		.pushConstantRangeCount = 1,
-		.pPushConstantRanges = &(VkPushConstantRange){
-			.offset = 0,
-			.size = sizeof(TransformationMatrix),
-			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT
+	size_t runCount = (count > 0) ? 1 : 0;
+	for(size_t i = 1;i < count;++i)
+	{
+		if(GetSortKeyState(keys[i]) != GetSortKeyState(keys[i - 1]))
+		{
+			++runCount;
 		}
-	};
-	VK_CHECK(vkCreatePipelineLayout(renderer.device,&pipelineLayoutCreateInfo,NULL,&renderer.pipelineLayout));
+	}
+	return runCount;
 }
 
-static void CreateShaderCompiler(void)
+//Stable LSD radix sort of the queued sort keys; outInstances are the instances in key order, which is the queue itself when it was already sorted.
+//The scratch arrays come from the frame arena.
+static bool SortQuadQueue(const QuadInstance** outInstances)
 {
-	renderer.shaderCompiler = shaderc_compiler_initialize();
-	if(!renderer.shaderCompiler)
+	size_t count = renderer.quadInstanceCount;
+	size_t unsortedIndex = 1;
+	while(unsortedIndex < count && renderer.quadSortKeys[unsortedIndex - 1] <= renderer.quadSortKeys[unsortedIndex])
 	{
-		AbortApplication("Couldn't create the shader compiler.");
+		++unsortedIndex;
+	}
+	if(unsortedIndex >= count)
+	{
+		*outInstances = renderer.quadInstances;
+		return true;
+	}
+
+	QuadInstance* sortedInstances = AllocateFrameMemory(count * sizeof(QuadInstance),_Alignof(QuadInstance));
+	uint64_t* keys = renderer.quadSortKeys;
+	uint64_t* scratchKeys = AllocateFrameMemory(count * sizeof(uint64_t),_Alignof(uint64_t));
+	uint32_t* indices = AllocateFrameMemory(count * sizeof(uint32_t),_Alignof(uint32_t));
+	uint32_t* scratchIndices = AllocateFrameMemory(count * sizeof(uint32_t),_Alignof(uint32_t));
+	if(!sortedInstances || !scratchKeys || !indices || !scratchIndices)
+	{
+		return false;
+	}
+
+	size_t histograms[8 - SORT_KEY_FIRST_SORTED_BYTE][256] = {0};
+	for(size_t i = 0;i < count;++i)
+	{
+		uint64_t key = keys[i];
+		for(int byte = SORT_KEY_FIRST_SORTED_BYTE;byte < 8;++byte)
+		{
+			++histograms[byte - SORT_KEY_FIRST_SORTED_BYTE][(key >> (byte * 8)) & 0xFF];
+		}
+		indices[i] = (uint32_t)i;
+	}
+	for(int byte = SORT_KEY_FIRST_SORTED_BYTE;byte < 8;++byte)
+	{
+		size_t* histogram = histograms[byte - SORT_KEY_FIRST_SORTED_BYTE];
+		//A byte that all keys share wouldn't move anything.
+		if(histogram[(keys[0] >> (byte * 8)) & 0xFF] == count)
+		{
+			continue;
+		}
+		size_t offset = 0;
+		for(size_t i = 0;i < 256;++i)
+		{
+			size_t bucketCount = histogram[i];
+			histogram[i] = offset;
+			offset += bucketCount;
+		}
+		for(size_t i = 0;i < count;++i)
+		{
+			uint64_t key = keys[i];
+			size_t destination = histogram[(key >> (byte * 8)) & 0xFF]++;
+			scratchKeys[destination] = key;
+			scratchIndices[destination] = indices[i];
+		}
+		uint64_t* swappedKeys = keys;
+		keys = scratchKeys;
+		scratchKeys = swappedKeys;
+		uint32_t* swappedIndices = indices;
+		indices = scratchIndices;
+		scratchIndices = swappedIndices;
+	}
+	for(size_t i = 0;i < count;++i)
+	{
+		sortedInstances[i] = renderer.quadInstances[indices[i]];
 	}
+	renderer.quadSortKeys = keys;
+	*outInstances = sortedInstances;
+	return true;
 }
 
-static void CreateShader(const char* source,size_t sourceLength,const char* name,shaderc_shader_kind shaderKind,VkShaderModule* outShaderModule)
+static VkPipeline GetQuadPipeline(uint64_t sortKey)
 {
-	shaderc_compilation_result_t result = shaderc_compile_into_spv(renderer.shaderCompiler,source,sourceLength,shaderKind,name,"main",NULL);
-	if(!result)
+	//Every blend mode and pipeline index maps to the one pipeline there is.
+	(void)sortKey;
+	return renderer.pipeline;
+}
+
+static void SetQuadViewport(VkCommandBuffer commandBuffer)
+{
+	vkCmdSetViewport(commandBuffer,0,1,&(VkViewport){
+		.width = (float)renderer.swapchainImageExtent.width,
+		.height = (float)renderer.swapchainImageExtent.height,
+		.maxDepth = 1.0f
+	});
+	vkCmdSetScissor(commandBuffer,0,1,&(VkRect2D){
+		.offset = {0,0},
+		.extent = renderer.swapchainImageExtent
+	});
+}
+
+//Returns false when the pipeline changed, so that the caller has to end its current draw before the bind.
+static bool IsQuadPipelineBound(const QuadBindState* state,VkPipeline pipeline)
+{
+	return state->pipeline == pipeline;
+}
+
+static void BindQuadState(VkCommandBuffer commandBuffer,VkPipeline pipeline,uint32_t matrixOffset,QuadBindState* state)
+{
+	if(state->pipeline != pipeline)
 	{
-		AbortApplication("Couldn't compile shader \"%s\".",name);
+		vkCmdBindPipeline(commandBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,pipeline);
+		state->pipeline = pipeline;
 	}
-	if(shaderc_result_get_num_errors(result) > 0)
+	if(!state->descriptorSetsBound)
 	{
-		char errorBuffer[2048] = {0};
-		strncpy(errorBuffer,shaderc_result_get_error_message(result),sizeof(errorBuffer) - 1);
-		shaderc_result_release(result);
-		AbortApplication("Error during compilation of shader \"%s\": %s",name,errorBuffer);
+		vkCmdBindDescriptorSets(commandBuffer,VK_PIPELINE_BIND_POINT_GRAPHICS,renderer.pipelineLayout,0,2,(VkDescriptorSet[]){renderer.transformationMatrixDescriptorSet,renderer.textureDescriptorSet},1,&matrixOffset);
+		state->descriptorSetsBound = true;
 	}
-
-	VkShaderModuleCreateInfo shaderModuleCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.codeSize = shaderc_result_get_length(result),
-		.pCode = (const uint32_t*)shaderc_result_get_bytes(result)
-	};
-	VK_CHECK(vkCreateShaderModule(renderer.device,&shaderModuleCreateInfo,NULL,outShaderModule),shaderc_result_release(result));
-	shaderc_result_release(result);
 }
 
-static void CreateShaders(void)
+//Static quads are drawn straight from their GPU buffer, so drawing them costs the same no matter how many there are.
+static void RecordStaticQuads(VkCommandBuffer commandBuffer,uint32_t matrixOffset,QuadBindState* state)
 {
-	const char vertexShaderSource[] = "#version 450\n"
-	"layout(location = 0) in vec2 position;"
-	"layout(location = 1) in vec2 textureCoords;"
-	"layout(location = 0) out vec2 passTextureCoords;"
-	"layout(set = 0,binding = 0) uniform TransformationMatrix"
-	"{"
-	"mat4 matrix;"
-	"};"
-	"layout(push_constant) uniform ObjectTransformationMatrix"
-	"{"
-	"mat4 objectMatrix;"
-	"};"
-	"void main(void)"
-	"{"
-	"gl_Position = matrix * objectMatrix * vec4(position,0.0,1.0);"
-	"passTextureCoords = textureCoords;"
-	"}";
-	CreateShader(vertexShaderSource,sizeof(vertexShaderSource) - 1,"vertex shader",shaderc_vertex_shader,&renderer.vertexShaderModule);
-
-	const char fragmentShaderModule[] = "#version 450\n"
-	"layout(location = 0) in vec2 passTextureCoords;"
-	"layout(location = 0) out vec4 outColor;"
-	"layout(set = 1,binding = 0) uniform sampler2D texture0;"
-	"void main(void)"
-	"{"
-	"outColor = texture(texture0,passTextureCoords);"
-	"}";
-	CreateShader(fragmentShaderModule,sizeof(fragmentShaderModule) - 1,"fragment shader",shaderc_fragment_shader,&renderer.fragmentShaderModule);
-}
-
-static void CreatePipeline(void)
+	if(renderer.staticQuadCount == 0)
+	{
+		return;
+	}
+	BindQuadState(commandBuffer,renderer.pipeline,matrixOffset,state);
+	vkCmdBindVertexBuffers(commandBuffer,0,2,(VkBuffer[]){renderer.quadBuffer.buffer,renderer.staticQuadBuffer.buffer},(VkDeviceSize[]){0,0});
+	vkCmdDraw(commandBuffer,(uint32_t)(renderer.quadBuffer.size / sizeof(Vertex)),(uint32_t)renderer.staticQuadCount,0,0);
+	++state->drawCallCount;
+}
+
+//Walks the sorted quads in runs that share blend mode, pipeline and texture and binds only what changed between runs.
+//Textures come from the bindless array, so runs only end the current draw when the pipeline changes.
+static void RecordQuadRuns(VkCommandBuffer commandBuffer,const FrameAllocation* instanceAllocation,uint32_t matrixOffset,size_t firstInstance,size_t instanceCount,QuadBindState* state)
 {
-	VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-		.vertexBindingDescriptionCount = 1,
-		.pVertexBindingDescriptions = &(VkVertexInputBindingDescription){
-			.binding = 0,
-			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-			.stride = sizeof(Vertex)
-		},
-		.vertexAttributeDescriptionCount = 2,
-		.pVertexAttributeDescriptions = (VkVertexInputAttributeDescription[]){
-			{
-				.binding = 0,
-				.format = VK_FORMAT_R32G32_SFLOAT,
-				.location = 0,
-				.offset = offsetof(Vertex,position)
-			},
+	vkCmdBindVertexBuffers(commandBuffer,0,2,(VkBuffer[]){renderer.quadBuffer.buffer,instanceAllocation->buffer},(VkDeviceSize[]){0,instanceAllocation->offset});
+
+	uint32_t vertexCount = (uint32_t)(renderer.quadBuffer.size / sizeof(Vertex));
+	size_t endInstance = firstInstance + instanceCount;
+	size_t drawBegin = firstInstance;
+	size_t runBegin = firstInstance;
+	while(runBegin < endInstance)
+	{
+		uint32_t runState = GetSortKeyState(renderer.quadSortKeys[runBegin]);
+		VkPipeline pipeline = GetQuadPipeline(renderer.quadSortKeys[runBegin]);
+		if(!IsQuadPipelineBound(state,pipeline))
+		{
+			if(drawBegin < runBegin)
 			{
-				.binding = 0,
-				.format = VK_FORMAT_R32G32_SFLOAT,
-				.location = 1,
-				.offset = offsetof(Vertex,textureCoords)
+				vkCmdDraw(commandBuffer,vertexCount,(uint32_t)(runBegin - drawBegin),0,(uint32_t)drawBegin);
+				++state->drawCallCount;
 			}
+			drawBegin = runBegin;
 		}
-	};
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
-	};
-	VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-		.polygonMode = VK_POLYGON_MODE_FILL,
-		.cullMode = VK_CULL_MODE_BACK_BIT,
-		.frontFace = VK_FRONT_FACE_CLOCKWISE,
-		.lineWidth = 1.0f
-	};
-	VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-		.attachmentCount = 1,
+		BindQuadState(commandBuffer,pipeline,matrixOffset,state);
+		//The layer isn't bound state, so runs ignore it.
+		do
+		{
+			++runBegin;
+		}
+		while(runBegin < endInstance && GetSortKeyState(renderer.quadSortKeys[runBegin]) == runState);
+	}
+	if(drawBegin < endInstance)
+	{
+		vkCmdDraw(commandBuffer,vertexCount,(uint32_t)(endInstance - drawBegin),0,(uint32_t)drawBegin);
+		++state->drawCallCount;
+	}
+}
+
+//Copies the dirty slots from the ring into the static quad buffer; staging has to hold staticQuadDirtyEnd - staticQuadDirtyBegin instances.
+static size_t UploadStaticQuads(VkCommandBuffer commandBuffer,const FrameAllocation* staging)
+{
+	VkBufferCopy regions[MAX_STATIC_QUAD_COPY_REGIONS] = {0};
+	uint32_t regionCount = 0;
+	size_t uploadCount = 0;
+	QuadInstance* stagingInstances = staging->data;
+	for(size_t i = renderer.staticQuadDirtyBegin;i < renderer.staticQuadDirtyEnd;++i)
+	{
+		if(!(renderer.staticQuadFlags[i] & STATIC_QUAD_DIRTY))
+		{
+			continue;
+		}
+		VkDeviceSize offset = i * sizeof(QuadInstance);
+		VkBufferCopy* lastRegion = (regionCount > 0) ? &regions[regionCount - 1] : NULL;
+		if(!lastRegion || (lastRegion->dstOffset + lastRegion->size != offset && regionCount < MAX_STATIC_QUAD_COPY_REGIONS))
+		{
+			regions[regionCount++] = (VkBufferCopy){
+				.srcOffset = staging->offset + uploadCount * sizeof(QuadInstance),
+				.dstOffset = offset
+			};
+			lastRegion = &regions[regionCount - 1];
+		}
+		//A merged region also uploads the clean slots in between, which still hold their current contents.
+		for(size_t j = (size_t)((lastRegion->dstOffset + lastRegion->size) / sizeof(QuadInstance));j <= i;++j)
+		{
+			uint8_t flags = renderer.staticQuadFlags[j];
+			stagingInstances[uploadCount++] = ((flags & STATIC_QUAD_USED) && (flags & STATIC_QUAD_VISIBLE)) ? renderer.staticQuads[j] : (QuadInstance){0};
+			renderer.staticQuadFlags[j] = flags & ~STATIC_QUAD_DIRTY;
+		}
+		lastRegion->size = offset + sizeof(QuadInstance) - lastRegion->dstOffset;
+	}
+	renderer.staticQuadDirtyBegin = 0;
+	renderer.staticQuadDirtyEnd = 0;
+	if(regionCount == 0)
+	{
+		return 0;
+	}
+
+	//Earlier frames may still read the buffer, and this frame's draws must see the copy.
+	vkCmdPipelineBarrier(commandBuffer,VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,0,NULL,0,NULL,0,NULL);
+	vkCmdCopyBuffer(commandBuffer,staging->buffer,renderer.staticQuadBuffer.buffer,regionCount,regions);
+	vkCmdPipelineBarrier(commandBuffer,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,0,1,&(VkMemoryBarrier){
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+	},0,NULL,0,NULL);
+	return uploadCount;
+}
+
+static void ReserveStaticQuadBuffer(void)
+{
+	if(renderer.staticQuadBufferCapacity >= renderer.staticQuadCount)
+	{
+		return;
+	}
+	//Earlier frames may still draw from the old buffer; like the frame ring, this only happens when there are more static quads than ever before.
+	VK_CHECK(vkQueueWaitIdle(renderer.graphicsQueue));
+	DestroyRenderingBuffer(renderer.device,renderer.staticQuadBuffer);
+	renderer.staticQuadBuffer = (RenderingBuffer){0};
+	renderer.staticQuadBufferCapacity = 0;
+	if(!CreateRenderingBuffer(renderer.device,&renderer.memoryAllocator,renderer.staticQuadCapacity * sizeof(QuadInstance),NULL,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,MEMORY_STRATEGY_FREE_LIST,&renderer.staticQuadBuffer))
+	{
+		AbortApplication(GetError());
+	}
+	CountFrameHeapAllocation();
+	renderer.staticQuadBufferCapacity = renderer.staticQuadCapacity;
+	for(size_t i = 0;i < renderer.staticQuadCount;++i)
+	{
+		renderer.staticQuadFlags[i] |= STATIC_QUAD_DIRTY;
+	}
+	renderer.staticQuadDirtyBegin = 0;
+	renderer.staticQuadDirtyEnd = renderer.staticQuadCount;
+}
+
+//Each partition copies its slice of the sorted instances into the ring and draws it from its own secondary command buffer.
+static void RecordQuadPartitions(void* userData,size_t begin,size_t end)
+{
+	QuadRecording* recording = userData;
+	for(size_t i = begin;i < end;++i)
+	{
+		size_t firstInstance = renderer.quadInstanceCount * i / recording->partitionCount;
+		size_t instanceCount = renderer.quadInstanceCount * (i + 1) / recording->partitionCount - firstInstance;
+		VkCommandBuffer commandBuffer = recording->frame->secondaryCommandBuffers[i];
+		VkCommandBufferBeginInfo commandBufferBeginInfo = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+			.pInheritanceInfo = &(VkCommandBufferInheritanceInfo){
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+				.renderPass = renderer.renderPass,
+				.subpass = 0,
+				.framebuffer = renderer.framebuffers[renderer.currentSwapchainIndex],
+				//The primary command buffer's statistics query stays active while the partitions execute.
+				.pipelineStatistics = GetGpuPipelineStatisticFlags(&renderer.gpuProfiler)
+			}
+		};
+		recording->results[i] = vkBeginCommandBuffer(commandBuffer,&commandBufferBeginInfo);
+		if(recording->results[i] != VK_SUCCESS)
+		{
+			continue;
+		}
+		memcpy((QuadInstance*)recording->instanceAllocation.data + firstInstance,&recording->instances[firstInstance],instanceCount * sizeof(QuadInstance));
+		//Secondary command buffers inherit no bound state.
+		QuadBindState state = {0};
+		//Timestamps aren't allowed in a subpass that executes secondary command buffers, but labels are.
+		BeginDebugLabel(commandBuffer,"Quad partition");
+		SetQuadViewport(commandBuffer);
+		if(i == 0)
+		{
+			RecordStaticQuads(commandBuffer,recording->matrixOffset,&state);
+		}
+		RecordQuadRuns(commandBuffer,&recording->instanceAllocation,recording->matrixOffset,firstInstance,instanceCount,&state);
+		EndDebugLabel(commandBuffer);
+		recording->drawCallCounts[i] = state.drawCallCount;
+		recording->results[i] = vkEndCommandBuffer(commandBuffer);
+	}
+}
+
+static void RecordCommandBuffer(FrameData* frame)
+{
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	VK_CHECK(vkBeginCommandBuffer(frame->commandBuffer,&commandBufferBeginInfo));
+	//The frame's fence was waited on, so the queries this slot wrote last time are available.
+	BeginGpuProfilerFrame(&renderer.gpuProfiler,frame->commandBuffer,renderer.currentFrame);
+	BeginGpuScope(&renderer.gpuProfiler,frame->commandBuffer,"Frame");
+
+	VkRenderPassBeginInfo renderPassBeginInfo = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+		.framebuffer = renderer.framebuffers[renderer.currentSwapchainIndex],
+		.renderPass = renderer.renderPass,
+		.renderArea = {
+			.offset = {0,0},
+			.extent = renderer.swapchainImageExtent
+		},
+		.clearValueCount = 1,
+		.pClearValues = &(VkClearValue){
+			.color = {
+				.float32 = {0.0f,0.0f,0.0f,1.0f}
+			}
+		}
+	};
+
+	renderer.statistics = (RenderStatistics){0};
+	//Until the worker delivers a pipeline for the current swapchain, frames are only cleared.
+	if(!renderer.pipeline)
+	{
+		BeginGpuScope(&renderer.gpuProfiler,frame->commandBuffer,"Clear");
+		vkCmdBeginRenderPass(frame->commandBuffer,&renderPassBeginInfo,VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdEndRenderPass(frame->commandBuffer);
+		EndGpuScope(&renderer.gpuProfiler,frame->commandBuffer);
+		RecordFrameCapture(frame);
+		EndGpuScope(&renderer.gpuProfiler,frame->commandBuffer);
+		VK_CHECK(vkEndCommandBuffer(frame->commandBuffer));
+		return;
+	}
+
+	//Per-frame data is written straight into the mapped ring; the queue submission makes host-coherent writes visible, so no transfer or barrier is needed.
+	//The ring isn't thread-safe, so all of it is allocated here even when other threads fill it.
+	ReserveStaticQuadBuffer();
+	VkDeviceSize instanceDataSize = renderer.quadInstanceCount * sizeof(QuadInstance);
+	VkDeviceSize staticUploadSize = (renderer.staticQuadDirtyEnd - renderer.staticQuadDirtyBegin) * sizeof(QuadInstance);
+	ReserveFrameData(instanceDataSize + staticUploadSize + _Alignof(QuadInstance) + renderer.minUniformBufferOffsetAlignment + sizeof(TransformationMatrix));
+	QuadRecording recording = {
+		.frame = frame
+	};
+	FrameAllocation staticUploadAllocation = {0};
+	FrameAllocation matrixAllocation = {0};
+	renderer.statistics.unsortedRunCount = CountQuadRuns(renderer.quadSortKeys,renderer.quadInstanceCount);
+	if(!SortQuadQueue(&recording.instances) ||
+	   !AllocateFrameData(&renderer.frameRing,instanceDataSize,_Alignof(QuadInstance),&recording.instanceAllocation) ||
+	   !AllocateFrameData(&renderer.frameRing,staticUploadSize,_Alignof(QuadInstance),&staticUploadAllocation) ||
+	   !AllocateFrameData(&renderer.frameRing,sizeof(TransformationMatrix),renderer.minUniformBufferOffsetAlignment,&matrixAllocation))
+	{
+		AbortApplication(GetError());
+	}
+	renderer.statistics.sortedRunCount = CountQuadRuns(renderer.quadSortKeys,renderer.quadInstanceCount);
+	recording.matrixOffset = (uint32_t)matrixAllocation.offset;
+	//Only the static quads that changed since the last recorded frame are copied; copies aren't allowed inside the render pass.
+	BeginGpuScope(&renderer.gpuProfiler,frame->commandBuffer,"Static quad upload");
+	renderer.statistics.staticQuadUploadCount = UploadStaticQuads(frame->commandBuffer,&staticUploadAllocation);
+	EndGpuScope(&renderer.gpuProfiler,frame->commandBuffer);
+	*(TransformationMatrix*)matrixAllocation.data = (TransformationMatrix){
+		.matrix = Mat4Orthographic(0,(float)renderer.swapchainImageExtent.width,0,(float)renderer.swapchainImageExtent.height,-1,1)
+	};
+
+	if(renderer.recordingPartitionCount > 1 && renderer.quadInstanceCount >= PARALLEL_RECORDING_THRESHOLD)
+	{
+		recording.partitionCount = (uint32_t)(renderer.quadInstanceCount / MIN_QUADS_PER_RECORDING_PARTITION);
+		if(recording.partitionCount > renderer.recordingPartitionCount)
+		{
+			recording.partitionCount = renderer.recordingPartitionCount;
+		}
+		JobCounter counter = {0};
+		ParallelFor(recording.partitionCount,1,RecordQuadPartitions,&recording,&counter);
+		WaitForJobs(&counter);
+		for(uint32_t i = 0;i < recording.partitionCount;++i)
+		{
+			if(recording.results[i] != VK_SUCCESS)
+			{
+				AbortApplication("Recording quad partition %u returned %s.",i,VkResultToString(recording.results[i]));
+			}
+			renderer.statistics.drawCallCount += recording.drawCallCounts[i];
+		}
+		//Secondary command buffers are executed in order, so quads are still drawn in sorted order.
+		BeginGpuScope(&renderer.gpuProfiler,frame->commandBuffer,"Quads");
+		BeginGpuPipelineStatistics(&renderer.gpuProfiler,frame->commandBuffer);
+		vkCmdBeginRenderPass(frame->commandBuffer,&renderPassBeginInfo,VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(frame->commandBuffer,recording.partitionCount,frame->secondaryCommandBuffers);
+	}
+	else
+	{
+		if(instanceDataSize > 0)
+		{
+			memcpy(recording.instanceAllocation.data,recording.instances,instanceDataSize);
+		}
+		BeginGpuScope(&renderer.gpuProfiler,frame->commandBuffer,"Quads");
+		BeginGpuPipelineStatistics(&renderer.gpuProfiler,frame->commandBuffer);
+		vkCmdBeginRenderPass(frame->commandBuffer,&renderPassBeginInfo,VK_SUBPASS_CONTENTS_INLINE);
+		//Every quad picks its texture from the bindless array, so the queue only needs a new draw call where the pipeline changes.
+		QuadBindState state = {0};
+		SetQuadViewport(frame->commandBuffer);
+		RecordStaticQuads(frame->commandBuffer,recording.matrixOffset,&state);
+		RecordQuadRuns(frame->commandBuffer,&recording.instanceAllocation,recording.matrixOffset,0,renderer.quadInstanceCount,&state);
+		renderer.statistics.drawCallCount = state.drawCallCount;
+	}
+	renderer.statistics.instanceCount = renderer.quadInstanceCount + renderer.staticQuadCount;
+	vkCmdEndRenderPass(frame->commandBuffer);
+	EndGpuPipelineStatistics(&renderer.gpuProfiler,frame->commandBuffer);
+	EndGpuScope(&renderer.gpuProfiler,frame->commandBuffer);
+	RecordFrameCapture(frame);
+
+	EndGpuScope(&renderer.gpuProfiler,frame->commandBuffer);
+	VK_CHECK(vkEndCommandBuffer(frame->commandBuffer));
+}
+
+static void CreatePipelineLayout(void)
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 2,
+		.pSetLayouts = (VkDescriptorSetLayout[]){
+			renderer.descriptorSetLayout,
+			renderer.textureDescriptorSetLayout
+		}
+	};
+	VK_CHECK(vkCreatePipelineLayout(renderer.device,&pipelineLayoutCreateInfo,NULL,&renderer.pipelineLayout));
+}
+
+static void CreateShaderModule(const uint32_t* code,size_t codeSize,VkShaderModule* outShaderModule)
+{
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = codeSize,
+		.pCode = code
+	};
+	VK_CHECK(vkCreateShaderModule(renderer.device,&shaderModuleCreateInfo,NULL,outShaderModule));
+}
+
+#ifdef RUNTIME_SHADERS
+static void CreateShaderCompiler(void)
+{
+	renderer.shaderCompiler = shaderc_compiler_initialize();
+	if(!renderer.shaderCompiler)
+	{
+		AbortApplication("Couldn't create the shader compiler.");
+	}
+}
+
+//Development mode: shaders are read from the source tree, so editing them only requires restarting the game.
+static void CreateShader(const char* fileName,shaderc_shader_kind shaderKind,VkShaderModule* outShaderModule)
+{
+	char filePath[1024] = {0};
+	snprintf(filePath,sizeof(filePath),"%s/%s",SHADER_SOURCE_DIRECTORY,fileName);
+	size_t sourceLength = 0;
+	char* source = SDL_LoadFile(filePath,&sourceLength);
+	if(!source)
+	{
+		AbortApplication("Couldn't load shader \"%s\": %s",filePath,SDL_GetError());
+	}
+
+	shaderc_compilation_result_t result = shaderc_compile_into_spv(renderer.shaderCompiler,source,sourceLength,shaderKind,fileName,"main",NULL);
+	SDL_free(source);
+	if(!result)
+	{
+		AbortApplication("Couldn't compile shader \"%s\".",fileName);
+	}
+	if(shaderc_result_get_num_errors(result) > 0)
+	{
+		char errorBuffer[2048] = {0};
+		strncpy(errorBuffer,shaderc_result_get_error_message(result),sizeof(errorBuffer) - 1);
+		shaderc_result_release(result);
+		AbortApplication("Error during compilation of shader \"%s\": %s",fileName,errorBuffer);
+	}
+	CreateShaderModule((const uint32_t*)shaderc_result_get_bytes(result),shaderc_result_get_length(result),outShaderModule);
+	shaderc_result_release(result);
+}
+
+static void CreateShaders(void)
+{
+	uint64_t startTimerValue = SDL_GetPerformanceCounter();
+	CreateShaderCompiler();
+	CreateShader("quad.vert",shaderc_vertex_shader,&renderer.vertexShaderModule);
+	CreateShader("quad.frag",shaderc_fragment_shader,&renderer.fragmentShaderModule);
+	double milliseconds = (double)(SDL_GetPerformanceCounter() - startTimerValue) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+	SDL_Log("Compiled shaders with shaderc in %.3f ms.",milliseconds);
+}
+#else
+//Generated at build time by glslc from the files in shaders/.
+static const uint32_t vertexShaderCode[] =
+#include "quad.vert.inc"
+;
+static const uint32_t fragmentShaderCode[] =
+#include "quad.frag.inc"
+;
+
+static void CreateShaders(void)
+{
+	uint64_t startTimerValue = SDL_GetPerformanceCounter();
+	CreateShaderModule(vertexShaderCode,sizeof(vertexShaderCode),&renderer.vertexShaderModule);
+	CreateShaderModule(fragmentShaderCode,sizeof(fragmentShaderCode),&renderer.fragmentShaderModule);
+	double milliseconds = (double)(SDL_GetPerformanceCounter() - startTimerValue) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+	SDL_Log("Created shaders from embedded SPIR-V in %.3f ms (build with CARKANOID_RUNTIME_SHADERS to compare against shaderc).",milliseconds);
+}
+#endif
+
+static VkResult CreatePipeline(VkRenderPass renderPass,VkPipeline* outPipeline)
+{
+	VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+		.vertexBindingDescriptionCount = 2,
+		.pVertexBindingDescriptions = (VkVertexInputBindingDescription[]){
+			{
+				.binding = 0,
+				.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+				.stride = sizeof(Vertex)
+			},
+			{
+				.binding = 1,
+				.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+				.stride = sizeof(QuadInstance)
+			}
+		},
+		.vertexAttributeDescriptionCount = 5,
+		.pVertexAttributeDescriptions = (VkVertexInputAttributeDescription[]){
+			{
+				.binding = 0,
+				.format = VK_FORMAT_R32G32_SFLOAT,
+				.location = 0,
+				.offset = offsetof(Vertex,position)
+			},
+			{
+				.binding = 0,
+				.format = VK_FORMAT_R32G32_SFLOAT,
+				.location = 1,
+				.offset = offsetof(Vertex,textureCoords)
+			},
+			{
+				.binding = 1,
+				.format = VK_FORMAT_R32G32_SFLOAT,
+				.location = 2,
+				.offset = offsetof(QuadInstance,position)
+			},
+			{
+				.binding = 1,
+				.format = VK_FORMAT_R32G32_SFLOAT,
+				.location = 3,
+				.offset = offsetof(QuadInstance,size)
+			},
+			{
+				.binding = 1,
+				.format = VK_FORMAT_R32_UINT,
+				.location = 4,
+				.offset = offsetof(QuadInstance,image)
+			}
+		}
+	};
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
+	};
+	VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.polygonMode = VK_POLYGON_MODE_FILL,
+		.cullMode = VK_CULL_MODE_BACK_BIT,
+		.frontFace = VK_FRONT_FACE_CLOCKWISE,
+		.lineWidth = 1.0f
+	};
+	VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.attachmentCount = 1,
 		.pAttachments = &(VkPipelineColorBlendAttachmentState){
 			.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
 			.blendEnable = VK_TRUE,
@@ -490,19 +1317,17 @@ static void CreatePipeline(void)
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
 		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
 	};
+	//Viewport and scissor are set while recording, so the pipeline survives window resizes.
 	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
 		.viewportCount = 1,
-		.pViewports = &(VkViewport){
-			.width = (float)renderer.swapchainImageExtent.width,
-			.height = (float)renderer.swapchainImageExtent.height,
-			.maxDepth = 1.0f
-		},
-		.scissorCount = 1,
-		.pScissors = &(VkRect2D){
-			.offset = {0,0},
-			.extent = renderer.swapchainImageExtent
-		}
+		.scissorCount = 1
+	};
+	VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = sizeof(dynamicStates) / sizeof(*dynamicStates),
+		.pDynamicStates = dynamicStates
 	};
 	VkPipelineShaderStageCreateInfo shaderStageCreateInfos[] = {
 		{
@@ -523,7 +1348,7 @@ static void CreatePipeline(void)
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.basePipelineIndex = -1,
 		.layout = renderer.pipelineLayout,
-		.renderPass = renderer.renderPass,
+		.renderPass = renderPass,
 		.pVertexInputState = &vertexInputStateCreateInfo,
 		.pInputAssemblyState = &inputAssemblyStateCreateInfo,
 		.pRasterizationState = &rasterizationStateCreateInfo,
@@ -531,10 +1356,190 @@ static void CreatePipeline(void)
 		.pDepthStencilState = &depthStencilStateCreateInfo,
 		.pMultisampleState = &multisampleStateCreateInfo,
 		.pViewportState = &viewportStateCreateInfo,
+		.pDynamicState = &dynamicStateCreateInfo,
 		.stageCount = sizeof(shaderStageCreateInfos) / sizeof(*shaderStageCreateInfos),
 		.pStages = shaderStageCreateInfos
 	};
-	VK_CHECK(vkCreateGraphicsPipelines(renderer.device,VK_NULL_HANDLE,1,&pipelineCreateInfo,NULL,&renderer.pipeline));
+	return vkCreateGraphicsPipelines(renderer.device,renderer.pipelineCache,1,&pipelineCreateInfo,NULL,outPipeline);
+}
+
+static int PipelineWorkerMain(void* userData)
+{
+	PipelineWorker* worker = userData;
+	SetProfilerThreadName("PipelineWorker");
+	SDL_LockMutex(worker->mutex);
+	while(true)
+	{
+		while(!worker->requested && !worker->quit)
+		{
+			SDL_CondWait(worker->condition,worker->mutex);
+		}
+		if(worker->quit)
+		{
+			break;
+		}
+		VkRenderPass renderPass = worker->requestedRenderPass;
+		worker->requested = false;
+		worker->building = true;
+		SDL_UnlockMutex(worker->mutex);
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		BeginProfilerZone("CreatePipeline");
+		VkResult result = CreatePipeline(renderPass,&pipeline);
+		EndProfilerZone();
+
+		SDL_LockMutex(worker->mutex);
+		//A result nobody picked up yet is outdated by now.
+		if(worker->builtPipeline)
+		{
+			vkDestroyPipeline(renderer.device,worker->builtPipeline,NULL);
+		}
+		worker->builtPipeline = pipeline;
+		worker->builtRenderPass = renderPass;
+		worker->buildResult = result;
+		worker->building = false;
+		SDL_CondBroadcast(worker->condition);
+	}
+	SDL_UnlockMutex(worker->mutex);
+	return 0;
+}
+
+static void CreatePipelineWorker(void)
+{
+	PipelineWorker* worker = &renderer.pipelineWorker;
+	worker->buildResult = VK_SUCCESS;
+	worker->mutex = SDL_CreateMutex();
+	if(!worker->mutex)
+	{
+		AbortApplication("Couldn't create a mutex: %s",SDL_GetError());
+	}
+	worker->condition = SDL_CreateCond();
+	if(!worker->condition)
+	{
+		AbortApplication("Couldn't create a condition variable: %s",SDL_GetError());
+	}
+	worker->thread = SDL_CreateThread(PipelineWorkerMain,"PipelineWorker",worker);
+	if(!worker->thread)
+	{
+		AbortApplication("Couldn't create the pipeline worker thread: %s",SDL_GetError());
+	}
+}
+
+static void DestroyPipelineWorker(void)
+{
+	PipelineWorker* worker = &renderer.pipelineWorker;
+	if(worker->thread)
+	{
+		SDL_LockMutex(worker->mutex);
+		worker->quit = true;
+		SDL_CondBroadcast(worker->condition);
+		SDL_UnlockMutex(worker->mutex);
+		SDL_WaitThread(worker->thread,NULL);
+	}
+	if(worker->builtPipeline)
+	{
+		vkDestroyPipeline(renderer.device,worker->builtPipeline,NULL);
+	}
+	SDL_DestroyCond(worker->condition);
+	SDL_DestroyMutex(worker->mutex);
+	*worker = (PipelineWorker){0};
+}
+
+static void RequestPipeline(void)
+{
+	PipelineWorker* worker = &renderer.pipelineWorker;
+	SDL_LockMutex(worker->mutex);
+	worker->requestedRenderPass = renderer.renderPass;
+	worker->requested = true;
+	SDL_CondBroadcast(worker->condition);
+	SDL_UnlockMutex(worker->mutex);
+}
+
+//The render pass given to the worker must stay alive until it's done, so this is called before destroying it.
+static void WaitForPipelineWorker(void)
+{
+	PipelineWorker* worker = &renderer.pipelineWorker;
+	SDL_LockMutex(worker->mutex);
+	while(worker->requested || worker->building)
+	{
+		SDL_CondWait(worker->condition,worker->mutex);
+	}
+	if(worker->builtPipeline)
+	{
+		vkDestroyPipeline(renderer.device,worker->builtPipeline,NULL);
+		worker->builtPipeline = VK_NULL_HANDLE;
+	}
+	SDL_UnlockMutex(worker->mutex);
+}
+
+//Unlike WaitForPipelineWorker, the finished pipeline is kept so that AcquireBuiltPipeline can pick it up.
+static void WaitForPipelineBuild(void)
+{
+	PipelineWorker* worker = &renderer.pipelineWorker;
+	SDL_LockMutex(worker->mutex);
+	while(worker->requested || worker->building)
+	{
+		SDL_CondWait(worker->condition,worker->mutex);
+	}
+	SDL_UnlockMutex(worker->mutex);
+}
+
+static void AcquireBuiltPipeline(void)
+{
+	PipelineWorker* worker = &renderer.pipelineWorker;
+	SDL_LockMutex(worker->mutex);
+	VkResult result = worker->buildResult;
+	if(worker->builtPipeline && worker->builtRenderPass == renderer.renderPass && !worker->requested)
+	{
+		//Pipelines are only replaced after the render pass was recreated, which already waited for the GPU.
+		if(renderer.pipeline)
+		{
+			vkDestroyPipeline(renderer.device,renderer.pipeline,NULL);
+		}
+		renderer.pipeline = worker->builtPipeline;
+		worker->builtPipeline = VK_NULL_HANDLE;
+	}
+	SDL_UnlockMutex(worker->mutex);
+	if(result != VK_SUCCESS)
+	{
+		AbortApplication("Function vkCreateGraphicsPipelines returned %s.",VkResultToString(result));
+	}
+}
+
+static void CreatePipelineCache(void)
+{
+	char* prefPath = SDL_GetPrefPath("TheHyper45","CArkanoid");
+	if(prefPath)
+	{
+		size_t pathLength = strlen(prefPath) + sizeof("pipeline_cache.bin");
+		renderer.pipelineCachePath = malloc(pathLength);
+		if(!renderer.pipelineCachePath)
+		{
+			AbortApplication("Couldn't allocate %zu bytes of memory.",pathLength);
+		}
+		snprintf(renderer.pipelineCachePath,pathLength,"%spipeline_cache.bin",prefPath);
+		SDL_free(prefPath);
+	}
+	if(!CreatePipelineCacheFromFile(renderer.device,renderer.physicalDevice,renderer.pipelineCachePath,&renderer.pipelineCache))
+	{
+		AbortApplication(GetError());
+	}
+}
+
+static void DestroyPipelineCache(void)
+{
+	if(!renderer.pipelineCache)
+	{
+		return;
+	}
+	//Losing the cache only costs startup time, so failing to save it isn't fatal.
+	if(renderer.pipelineCachePath && !SavePipelineCacheToFile(renderer.device,renderer.pipelineCache,renderer.pipelineCachePath))
+	{
+		SDL_Log("Couldn't save the pipeline cache: %s",GetError());
+	}
+	vkDestroyPipelineCache(renderer.device,renderer.pipelineCache,NULL);
+	free(renderer.pipelineCachePath);
+	renderer.pipelineCachePath = NULL;
 }
 
 static void CreateDescriptorSetLayouts(void)
@@ -545,44 +1550,110 @@ static void CreateDescriptorSetLayouts(void)
 		.pBindings = &(VkDescriptorSetLayoutBinding){
 			.binding = 0,
 			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT
 		}
 	};
 	VK_CHECK(vkCreateDescriptorSetLayout(renderer.device,&descriptorSetLayoutCreateInfo,NULL,&renderer.descriptorSetLayout));
 
-	VkDescriptorSetLayoutCreateInfo materialDescriptorSetLayoutCreateInfo = {
+	//Textures live in a single partially bound array indexed by Image, so the set is bound once per frame.
+	VkDescriptorSetLayoutCreateInfo textureDescriptorSetLayoutCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.bindingCount = 1,
-		.pBindings = &(VkDescriptorSetLayoutBinding){
-			.binding = 0,
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
-		}
-	};
-	VK_CHECK(vkCreateDescriptorSetLayout(renderer.device,&materialDescriptorSetLayoutCreateInfo,NULL,&renderer.materialDescriptorSetLayout));
-}
-
-static void CreateDescriptorPool(void)
-{
-	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-		.maxSets = 16,
-		.poolSizeCount = 2,
-		.pPoolSizes = (VkDescriptorPoolSize[]){
+		.pNext = &(VkDescriptorSetLayoutBindingFlagsCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.bindingCount = 2,
+			.pBindingFlags = (VkDescriptorBindingFlags[]){
+				0,
+				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+			}
+		},
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = 2,
+		.pBindings = (VkDescriptorSetLayoutBinding[]){
 			{
+				.binding = 0,
 				.descriptorCount = 1,
-				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+				.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+				.pImmutableSamplers = &renderer.sampler
 			},
 			{
-				.descriptorCount = 16,
-				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+				.binding = 1,
+				.descriptorCount = renderer.maxTextureCount,
+				.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
 			}
 		}
 	};
-	VK_CHECK(vkCreateDescriptorPool(renderer.device,&descriptorPoolCreateInfo,NULL,&renderer.descriptorPool));
+	VK_CHECK(vkCreateDescriptorSetLayout(renderer.device,&textureDescriptorSetLayoutCreateInfo,NULL,&renderer.textureDescriptorSetLayout));
+}
+
+static void CreateDescriptorSetAllocator(void)
+{
+	VkDescriptorPoolSize poolSizes[] = {
+		{
+			.descriptorCount = 1,
+			.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+		},
+		{
+			.descriptorCount = 1,
+			.type = VK_DESCRIPTOR_TYPE_SAMPLER
+		},
+		{
+			.descriptorCount = INITIAL_TEXTURE_CAPACITY,
+			.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+		}
+	};
+	if(!CreateDescriptorAllocator(renderer.device,VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT | VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,poolSizes,sizeof(poolSizes) / sizeof(*poolSizes),4,&renderer.descriptorAllocator))
+	{
+		AbortApplication(GetError());
+	}
+}
+
+//Allocates a texture set with room for newCapacity textures and copies all existing texture descriptors into it.
+static bool GrowTextureDescriptorSet(uint32_t newCapacity)
+{
+	if(newCapacity > renderer.maxTextureCount)
+	{
+		newCapacity = renderer.maxTextureCount;
+	}
+	if(newCapacity <= renderer.textureCapacity)
+	{
+		SetError("Couldn't load more than %u textures.",renderer.maxTextureCount);
+		return false;
+	}
+
+	VkDescriptorSet newSet = VK_NULL_HANDLE;
+	VkDescriptorPool newPool = VK_NULL_HANDLE;
+	if(!AllocateDescriptorSet(renderer.device,&renderer.descriptorAllocator,renderer.textureDescriptorSetLayout,newCapacity,&newSet,&newPool))
+	{
+		return false;
+	}
+	for(size_t i = 0;i < renderer.imageCount;++i)
+	{
+		vkUpdateDescriptorSets(renderer.device,1,&(VkWriteDescriptorSet){
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			.dstArrayElement = (uint32_t)i,
+			.dstBinding = 1,
+			.dstSet = newSet,
+			.pImageInfo = &(VkDescriptorImageInfo){
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.imageView = renderer.images[i].image.imageView
+			}
+		},0,NULL);
+	}
+	//The old set may still be used by frames in flight; growing is rare, so simply wait for them to finish.
+	if(renderer.textureDescriptorSet)
+	{
+		VK_CHECK(vkQueueWaitIdle(renderer.graphicsQueue));
+		vkFreeDescriptorSets(renderer.device,renderer.textureDescriptorPool,1,&renderer.textureDescriptorSet);
+	}
+	renderer.textureDescriptorSet = newSet;
+	renderer.textureDescriptorPool = newPool;
+	renderer.textureCapacity = newCapacity;
+	return true;
 }
 
 static void CreateSampler(void)
@@ -597,15 +1668,50 @@ static void CreateSampler(void)
 	VK_CHECK(vkCreateSampler(renderer.device,&samplerCreateInfo,NULL,&renderer.sampler));
 }
 
-static void CreateSwapchainRelatives(void)
+static void DestroyFormatDependentObjects(void)
 {
-	CreateSwapchain();
+	WaitForPipelineWorker();
+	vkDestroyPipeline(renderer.device,renderer.pipeline,NULL);
+	renderer.pipeline = VK_NULL_HANDLE;
+	vkDestroyRenderPass(renderer.device,renderer.renderPass,NULL);
+	renderer.renderPass = VK_NULL_HANDLE;
+}
+
+//The render pass and the pipeline only depend on the surface format, which practically never changes on a resize.
+static void CreateFormatDependentObjects(void)
+{
+	if(renderer.renderPass && renderer.renderPassFormat == renderer.swapchainFormat.format)
+	{
+		return;
+	}
+	//Frames still in flight use the old render pass and pipeline.
+	if(renderer.renderPass)
+	{
+		VK_CHECK(vkQueueWaitIdle(renderer.graphicsQueue));
+	}
+	DestroyFormatDependentObjects();
+	CreateRenderPass();
+	renderer.renderPassFormat = renderer.swapchainFormat.format;
+	RequestPipeline();
+}
+
+static void CreateSwapchainRelatives(VkSwapchainKHR oldSwapchain)
+{
+	if(renderer.headless)
+	{
+		CreateOffscreenTargets();
+	}
+	else
+	{
+		CreateSwapchain(oldSwapchain);
+	}
 	if(!renderer.noSwapchain)
 	{
-		CreateRenderPass();
-		CreatePipeline();
+		CreateFormatDependentObjects();
 		CreateFramebuffers();
 	}
+	//The image, view, semaphore and framebuffer arrays come from the heap.
+	CountFrameHeapAllocation();
 }
 
 static void DestroySwapchainRelatives(void)
@@ -620,35 +1726,128 @@ static void DestroySwapchainRelatives(void)
 	}
 	free(renderer.framebuffers);
 	renderer.framebuffers = NULL;
-	vkDestroyPipeline(renderer.device,renderer.pipeline,NULL);
-	renderer.pipeline = VK_NULL_HANDLE;
-	vkDestroyRenderPass(renderer.device,renderer.renderPass,NULL);
-	renderer.renderPass = VK_NULL_HANDLE;
 	for(uint32_t i = 0;i < renderer.swapchainImageCount;++i)
 	{
-		vkDestroyImageView(renderer.device,renderer.swapchainImageViews[i],NULL);
+		if(renderer.headless)
+		{
+			DestroyRenderingImage(renderer.device,renderer.offscreenImages[i]);
+		}
+		else
+		{
+			vkDestroyImageView(renderer.device,renderer.swapchainImageViews[i],NULL);
+			vkDestroySemaphore(renderer.device,renderer.imageRenderSemaphores[i],NULL);
+		}
 	}
 	renderer.swapchainImageCount = 0;
+	free(renderer.imageRenderSemaphores);
+	renderer.imageRenderSemaphores = NULL;
 	free(renderer.swapchainImageViews);
 	renderer.swapchainImageViews = NULL;
 	free(renderer.swapchainImages);
 	renderer.swapchainImages = NULL;
-	vkDestroySwapchainKHR(renderer.device,renderer.swapchain,NULL);
+	if(renderer.swapchain)
+	{
+		vkDestroySwapchainKHR(renderer.device,renderer.swapchain,NULL);
+		renderer.swapchain = VK_NULL_HANDLE;
+	}
+}
+
+static void DestroyRetiredSwapchain(const RetiredSwapchain* retired)
+{
+	for(uint32_t i = 0;i < retired->imageCount;++i)
+	{
+		vkDestroyFramebuffer(renderer.device,retired->framebuffers[i],NULL);
+		vkDestroyImageView(renderer.device,retired->imageViews[i],NULL);
+		vkDestroySemaphore(renderer.device,retired->imageRenderSemaphores[i],NULL);
+	}
+	free(retired->framebuffers);
+	free(retired->imageViews);
+	free(retired->imageRenderSemaphores);
+	vkDestroySwapchainKHR(renderer.device,retired->swapchain,NULL);
+}
+
+//The queue finishes submissions in order, so any finished frame with a serial at least this large proves it.
+//Every slot is checked, since the newest frame may be in one that SetFramesInFlight stopped using.
+static bool IsFrameSerialFinished(uint64_t serial)
+{
+	for(uint32_t i = 0;i < MAX_FRAMES_IN_FLIGHT;++i)
+	{
+		const FrameData* frame = &renderer.frames[i];
+		if(frame->submittedSerial >= serial && vkGetFenceStatus(renderer.device,frame->fence) == VK_SUCCESS)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//A retired swapchain goes once a frame submitted after it was replaced has finished;
+//that frame's fence also covers the last present from the old swapchain, which was queued before it.
+static void DestroyRetiredSwapchains(bool all)
+{
+	uint32_t destroyedCount = 0;
+	while(destroyedCount < renderer.retiredSwapchainCount)
+	{
+		const RetiredSwapchain* retired = &renderer.retiredSwapchains[destroyedCount];
+		if(!all && !IsFrameSerialFinished(retired->lastFrameSerial + 1))
+		{
+			break;
+		}
+		DestroyRetiredSwapchain(retired);
+		++destroyedCount;
+	}
+	renderer.retiredSwapchainCount -= destroyedCount;
+	memmove(renderer.retiredSwapchains,renderer.retiredSwapchains + destroyedCount,renderer.retiredSwapchainCount * sizeof(renderer.retiredSwapchains[0]));
+}
+
+//Frames still in flight keep using the old images, so they're retired instead of waiting for the queue to go idle.
+static void RecreateSwapchainRelatives(void)
+{
+	RestartFrameArenaWarmUp();
+	if(renderer.headless)
+	{
+		DestroySwapchainRelatives();
+		CreateSwapchainRelatives(VK_NULL_HANDLE);
+		return;
+	}
+	if(renderer.retiredSwapchainCount == MAX_RETIRED_SWAPCHAINS)
+	{
+		VK_CHECK(vkQueueWaitIdle(renderer.graphicsQueue));
+		DestroyRetiredSwapchains(true);
+	}
+	renderer.retiredSwapchains[renderer.retiredSwapchainCount++] = (RetiredSwapchain){
+		.swapchain = renderer.swapchain,
+		.imageCount = renderer.swapchainImageCount,
+		.imageViews = renderer.swapchainImageViews,
+		.framebuffers = renderer.framebuffers,
+		.imageRenderSemaphores = renderer.imageRenderSemaphores,
+		.lastFrameSerial = renderer.frameSerial
+	};
+	VkSwapchainKHR oldSwapchain = renderer.swapchain;
+	free(renderer.swapchainImages);
+	renderer.swapchainImages = NULL;
+	renderer.swapchainImageViews = NULL;
+	renderer.framebuffers = NULL;
+	renderer.imageRenderSemaphores = NULL;
+	renderer.swapchainImageCount = 0;
 	renderer.swapchain = VK_NULL_HANDLE;
+	CreateSwapchainRelatives(oldSwapchain);
 }
 
 void InitRenderer(void)
 {
-	CreateShaderCompiler();
+	renderer.headless = IsHeadless();
 	CreateDevice();
 	CreateSampler();
 	CreateDescriptorSetLayouts();
-	CreateDescriptorPool();
+	CreateDescriptorSetAllocator();
 	CreateShaders();
 	CreatePipelineLayout();
-	CreateSemaphores();
-	CreateRenderingCommandPoolAndBuffer();
-	CreateSwapchainRelatives();
+	CreatePipelineCache();
+	CreatePipelineWorker();
+	CreateSynchronizationObjects();
+	CreateCommandPools();
+	CreateSwapchainRelatives(VK_NULL_HANDLE);
 
 	Vertex quadVertices[] = {
 		{{0,0},{0,0}},
@@ -658,46 +1857,23 @@ void InitRenderer(void)
 		{{1,1},{1,1}},
 		{{0,1},{0,1}},
 	};
-	if(!CreateRenderingBuffer(renderer.device,renderer.physicalDevice,sizeof(quadVertices),quadVertices,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,&renderer.quadBuffer))
+	if(!CreateRenderingBuffer(renderer.device,&renderer.memoryAllocator,sizeof(quadVertices),quadVertices,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,MEMORY_STRATEGY_FREE_LIST,&renderer.quadBuffer))
 	{
 		AbortApplication(GetError());
 	}
-	if(!CreateRenderingBuffer(renderer.device,renderer.physicalDevice,sizeof(TransformationMatrix),NULL,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,&renderer.transformationMatrixBuffer))
+
+	if(!AllocateDescriptorSet(renderer.device,&renderer.descriptorAllocator,renderer.descriptorSetLayout,0,&renderer.transformationMatrixDescriptorSet,NULL))
 	{
 		AbortApplication(GetError());
 	}
-
-	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-		.descriptorPool = renderer.descriptorPool,
-		.descriptorSetCount = 1,
-		.pSetLayouts = &renderer.descriptorSetLayout
-	};
-	VK_CHECK(vkAllocateDescriptorSets(renderer.device,&descriptorSetAllocateInfo,&renderer.transformationMatrixDescriptorSet));
-
-	VkWriteDescriptorSet writeDescriptorSet = {
-		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-		.descriptorCount = 1,
-		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		.dstArrayElement = 0,
-		.dstBinding = 0,
-		.dstSet = renderer.transformationMatrixDescriptorSet,
-		.pBufferInfo = &(VkDescriptorBufferInfo){
-			.buffer = renderer.transformationMatrixBuffer.buffer,
-			.offset = 0,
-			.range = renderer.transformationMatrixBuffer.size
-		},
-		.pImageInfo = NULL,
-		.pTexelBufferView = NULL
-	};
-	vkUpdateDescriptorSets(renderer.device,1,&writeDescriptorSet,0,NULL);
-
-	renderer.quadRenderCommandCapacity = 256;
-	renderer.quadRenderCommands = malloc(renderer.quadRenderCommandCapacity * sizeof(*renderer.quadRenderCommands));
-	if(!renderer.quadRenderCommands)
+	if(!GrowTextureDescriptorSet(INITIAL_TEXTURE_CAPACITY))
 	{
-		AbortApplication("Couldn't allocate %zu bytes of memory.",renderer.quadRenderCommandCapacity * sizeof(*renderer.quadRenderCommands));
+		AbortApplication(GetError());
 	}
+
+	WriteFrameRingDescriptor();
+
+	renderer.framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
 }
 
 void TermRenderer(void)
@@ -708,71 +1884,225 @@ void TermRenderer(void)
 		{
 			vkQueueWaitIdle(renderer.graphicsQueue);
 		}
-		free(renderer.quadRenderCommands);
+		for(uint32_t i = 0;i < MAX_FRAMES_IN_FLIGHT;++i)
+		{
+			vkDestroyCommandPool(renderer.device,renderer.frames[i].commandPool,NULL);
+			for(uint32_t j = 0;j < MAX_RECORDING_PARTITIONS;++j)
+			{
+				vkDestroyCommandPool(renderer.device,renderer.frames[i].secondaryCommandPools[j],NULL);
+			}
+			vkDestroyFence(renderer.device,renderer.frames[i].fence,NULL);
+			vkDestroySemaphore(renderer.device,renderer.frames[i].imageAcquireSemaphore,NULL);
+		}
+		DestroyUploadQueue(&renderer.uploadQueue);
+		DestroyGpuProfiler(&renderer.uploadProfiler);
+		DestroyGpuProfiler(&renderer.gpuProfiler);
+		DestroyFrameRing(&renderer.frameRing);
+		UnloadTexturePack();
 		for(size_t i = 0;i < renderer.imageCount;++i)
 		{
-			vkFreeDescriptorSets(renderer.device,renderer.descriptorPool,1,&renderer.images[i].descriptorSet);
 			DestroyRenderingImage(renderer.device,renderer.images[i].image);
 		}
+		free(renderer.images);
 
-		DestroyRenderingBuffer(renderer.device,renderer.transformationMatrixBuffer);
+		DestroyRenderingBuffer(renderer.device,renderer.staticQuadBuffer);
+		free(renderer.staticQuads);
+		free(renderer.staticQuadFlags);
+		free(renderer.freeStaticQuads);
+		DestroyRenderingBuffer(renderer.device,renderer.captureBuffer);
+		free(renderer.capturePath);
 		DestroyRenderingBuffer(renderer.device,renderer.quadBuffer);
 		DestroySwapchainRelatives();
-		vkDestroyCommandPool(renderer.device,renderer.renderingCommandPool,NULL);
-		vkDestroySemaphore(renderer.device,renderer.imageRenderSemaphore,NULL);
-		vkDestroySemaphore(renderer.device,renderer.imageAcquireSemaphore,NULL);
+		DestroyRetiredSwapchains(true);
+		DestroyFormatDependentObjects();
+		DestroyPipelineWorker();
+		DestroyPipelineCache();
 		vkDestroyPipelineLayout(renderer.device,renderer.pipelineLayout,NULL);
 		vkDestroyShaderModule(renderer.device,renderer.fragmentShaderModule,NULL);
 		vkDestroyShaderModule(renderer.device,renderer.vertexShaderModule,NULL);
-		vkDestroyDescriptorPool(renderer.device,renderer.descriptorPool,NULL);
-		vkDestroyDescriptorSetLayout(renderer.device,renderer.materialDescriptorSetLayout,NULL);
+		DestroyDescriptorAllocator(renderer.device,&renderer.descriptorAllocator);
+		vkDestroyDescriptorSetLayout(renderer.device,renderer.textureDescriptorSetLayout,NULL);
 		vkDestroyDescriptorSetLayout(renderer.device,renderer.descriptorSetLayout,NULL);
 		vkDestroySampler(renderer.device,renderer.sampler,NULL);
+		DestroyMemoryAllocator(&renderer.memoryAllocator);
+	}
+	vkDestroyDevice(renderer.device,NULL);
+#ifdef RUNTIME_SHADERS
+	shaderc_compiler_release(renderer.shaderCompiler);
+#endif
+}
+
+//Paths ending with ".png" are saved through SDL_image, everything else as a binary PPM.
+static bool WriteFrameCapture(const char* filePath)
+{
+	uint32_t width = renderer.swapchainImageExtent.width;
+	uint32_t height = renderer.swapchainImageExtent.height;
+	uint8_t* texels = renderer.captureBuffer.allocation.mappedData;
+	size_t pathLength = strlen(filePath);
+	if(pathLength >= 4 && strcmp(filePath + pathLength - 4,".png") == 0)
+	{
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(texels,(int)width,(int)height,32,(int)width * 4,SDL_PIXELFORMAT_RGBA32);
+		if(!surface)
+		{
+			SetError("%s",SDL_GetError());
+			return false;
+		}
+		int result = IMG_SavePNG(surface,filePath);
+		SDL_FreeSurface(surface);
+		if(result != 0)
+		{
+			SetError("Couldn't save \"%s\": %s",filePath,IMG_GetError());
+			return false;
+		}
+		return true;
+	}
+
+	uint8_t* row = malloc((size_t)width * 3);
+	if(!row)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",(size_t)width * 3);
+		return false;
+	}
+	CountFrameHeapAllocation();
+	FILE* file = fopen(filePath,"wb");
+	if(!file)
+	{
+		free(row);
+		SetError("Couldn't open \"%s\" for writing.",filePath);
+		return false;
 	}
-	vkDestroyDevice(renderer.device,NULL);
-	shaderc_compiler_release(renderer.shaderCompiler);
+	bool written = fprintf(file,"P6\n%u %u\n255\n",width,height) > 0;
+	for(uint32_t y = 0;y < height && written;++y)
+	{
+		const uint8_t* source = texels + (size_t)y * width * 4;
+		for(uint32_t x = 0;x < width;++x)
+		{
+			row[x * 3 + 0] = source[x * 4 + 0];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + 2];
+		}
+		written = fwrite(row,3,width,file) == width;
+	}
+	free(row);
+	if(fclose(file) != 0 || !written)
+	{
+		SetError("Couldn't write \"%s\".",filePath);
+		return false;
+	}
+	return true;
 }
 
 void BeginRendering(void)
 {
-	renderer.quadRenderCommandCount = 0;
+	//Waiting here instead of after presenting lets the game update run while the GPU still renders earlier frames.
+	FrameData* frame = &renderer.frames[renderer.currentFrame];
+	BeginProfilerZone("vkWaitForFences");
+	VK_CHECK(vkWaitForFences(renderer.device,1,&frame->fence,VK_TRUE,UINT64_MAX));
+	EndProfilerZone();
+	DestroyRetiredSwapchains(false);
+	VK_CHECK(vkResetCommandPool(renderer.device,frame->commandPool,0));
+	for(uint32_t i = 0;i < renderer.recordingPartitionCount && frame->secondaryCommandPools[i];++i)
+	{
+		VK_CHECK(vkResetCommandPool(renderer.device,frame->secondaryCommandPools[i],0));
+	}
+	BeginFrameRingPartition(&renderer.frameRing,renderer.currentFrame);
+	renderer.quadInstances = NULL;
+	renderer.quadSortKeys = NULL;
+	renderer.quadInstanceCount = 0;
+	renderer.quadInstanceCapacity = 0;
 }
 
 void EndRendering(void)
 {
+	BeginProfilerZone("FlushUploads");
+	if(!FlushUploads(&renderer.uploadQueue))
+	{
+		AbortApplication(GetError());
+	}
+	EndProfilerZone();
 	if(renderer.noSwapchain)
 	{
 		if(!IsMainWindowMinimized())
 		{
-			CreateSwapchainRelatives();
+			RestartFrameArenaWarmUp();
+			CreateSwapchainRelatives(VK_NULL_HANDLE);
 		}
 		return;
 	}
 
-	VkResult result = vkAcquireNextImageKHR(renderer.device,renderer.swapchain,UINT64_MAX,renderer.imageAcquireSemaphore,VK_NULL_HANDLE,&renderer.currentSwapchainIndex);
-	if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+	FrameData* frame = &renderer.frames[renderer.currentFrame];
+	if(renderer.headless)
 	{
-		DestroySwapchainRelatives();
-		CreateSwapchainRelatives();
-		return;
+		renderer.currentSwapchainIndex = renderer.currentFrame;
+		//A capture should show the scene, so it waits for the pipeline instead of recording a cleared frame.
+		if(renderer.capturePath)
+		{
+			WaitForPipelineBuild();
+		}
 	}
-	else if(result != VK_SUCCESS)
+	else
 	{
-		AbortApplication("Function vkAcquireNextImageKHR returned %s.",VkResultToString(result));
+		BeginProfilerZone("vkAcquireNextImageKHR");
+		VkResult result = vkAcquireNextImageKHR(renderer.device,renderer.swapchain,UINT64_MAX,frame->imageAcquireSemaphore,VK_NULL_HANDLE,&renderer.currentSwapchainIndex);
+		EndProfilerZone();
+		if(result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			RecreateSwapchainRelatives();
+			return;
+		}
+		else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			AbortApplication("Function vkAcquireNextImageKHR returned %s.",VkResultToString(result));
+		}
 	}
-	RecordCommandBuffer();
+	AcquireBuiltPipeline();
+	BeginProfilerZone("RecordCommandBuffer");
+	RecordCommandBuffer(frame);
+	EndProfilerZone();
 
+	//Waiting for the latest upload batch makes every texture loaded so far safe to sample in this frame.
+	//Offscreen images are never acquired, so only the upload semaphore is waited on in that case.
+	VkSemaphore waitSemaphores[] = {renderer.uploadQueue.timelineSemaphore,frame->imageAcquireSemaphore};
+	uint64_t waitSemaphoreValues[] = {renderer.uploadQueue.submittedValue,0};
+	VkPipelineStageFlags waitDstStageMasks[] = {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+	uint32_t waitSemaphoreCount = renderer.headless ? 1 : 2;
 	VkSubmitInfo submitInfo = {
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &(VkTimelineSemaphoreSubmitInfo){
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.waitSemaphoreValueCount = waitSemaphoreCount,
+			.pWaitSemaphoreValues = waitSemaphoreValues
+		},
 		.commandBufferCount = 1,
-		.pCommandBuffers = &renderer.renderingCommandBuffer,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &renderer.imageAcquireSemaphore,
-		.pWaitDstStageMask = &(VkPipelineStageFlags){VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &renderer.imageRenderSemaphore
+		.pCommandBuffers = &frame->commandBuffer,
+		.waitSemaphoreCount = waitSemaphoreCount,
+		.pWaitSemaphores = waitSemaphores,
+		.pWaitDstStageMask = waitDstStageMasks,
+		.signalSemaphoreCount = renderer.headless ? 0 : 1,
+		.pSignalSemaphores = renderer.headless ? NULL : &renderer.imageRenderSemaphores[renderer.currentSwapchainIndex]
 	};
-	VK_CHECK(vkQueueSubmit(renderer.graphicsQueue,1,&submitInfo,VK_NULL_HANDLE));
+	VK_CHECK(vkResetFences(renderer.device,1,&frame->fence));
+	BeginProfilerZone("vkQueueSubmit");
+	VK_CHECK(vkQueueSubmit(renderer.graphicsQueue,1,&submitInfo,frame->fence));
+	EndProfilerZone();
+	frame->submittedSerial = ++renderer.frameSerial;
+	renderer.currentFrame = (renderer.currentFrame + 1) % renderer.framesInFlight;
+
+	if(renderer.headless)
+	{
+		if(renderer.capturePath)
+		{
+			VK_CHECK(vkWaitForFences(renderer.device,1,&frame->fence,VK_TRUE,UINT64_MAX));
+			bool written = WriteFrameCapture(renderer.capturePath);
+			free(renderer.capturePath);
+			renderer.capturePath = NULL;
+			if(!written)
+			{
+				AbortApplication(GetError());
+			}
+		}
+		return;
+	}
 
 	VkPresentInfoKHR presentInfo = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -780,61 +2110,120 @@ void EndRendering(void)
 		.pSwapchains = &renderer.swapchain,
 		.pImageIndices = &renderer.currentSwapchainIndex,
 		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &renderer.imageRenderSemaphore
+		.pWaitSemaphores = &renderer.imageRenderSemaphores[renderer.currentSwapchainIndex]
 	};
 
-	result = vkQueuePresentKHR(renderer.graphicsQueue,&presentInfo);
+	BeginProfilerZone("vkQueuePresentKHR");
+	VkResult result = vkQueuePresentKHR(renderer.graphicsQueue,&presentInfo);
+	EndProfilerZone();
 	if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 	{
-		DestroySwapchainRelatives();
-		CreateSwapchainRelatives();
-		return;
+		RecreateSwapchainRelatives();
 	}
 	else if(result != VK_SUCCESS)
 	{
-		AbortApplication("Function vkAcquireNextImageKHR returned %s.",VkResultToString(result));
+		AbortApplication("Function vkQueuePresentKHR returned %s.",VkResultToString(result));
+	}
+}
+
+bool RequestFrameCapture(const char* filePath)
+{
+	if(!renderer.headless)
+	{
+		SetError("Frames can only be captured when rendering offscreen.");
+		return false;
+	}
+	VkDeviceSize size = (VkDeviceSize)renderer.swapchainImageExtent.width * renderer.swapchainImageExtent.height * 4;
+	if(renderer.captureBuffer.size != size)
+	{
+		DestroyRenderingBuffer(renderer.device,renderer.captureBuffer);
+		renderer.captureBuffer = (RenderingBuffer){0};
+		if(!CreateRenderingBuffer(renderer.device,&renderer.memoryAllocator,size,NULL,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,VK_BUFFER_USAGE_TRANSFER_DST_BIT,MEMORY_STRATEGY_FREE_LIST,&renderer.captureBuffer))
+		{
+			renderer.captureBuffer = (RenderingBuffer){0};
+			return false;
+		}
+		CountFrameHeapAllocation();
+	}
+	size_t pathSize = strlen(filePath) + 1;
+	char* path = malloc(pathSize);
+	if(!path)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",pathSize);
+		return false;
+	}
+	CountFrameHeapAllocation();
+	memcpy(path,filePath,pathSize);
+	free(renderer.capturePath);
+	renderer.capturePath = path;
+	return true;
+}
+
+void SetFramesInFlight(uint32_t count)
+{
+	if(count < 1)
+	{
+		count = 1;
+	}
+	if(count > MAX_FRAMES_IN_FLIGHT)
+	{
+		count = MAX_FRAMES_IN_FLIGHT;
+	}
+	if(count == renderer.framesInFlight)
+	{
+		return;
 	}
+	//All fences are signaled once the queue is idle, so the ring can restart from the first frame.
 	VK_CHECK(vkQueueWaitIdle(renderer.graphicsQueue));
+	renderer.framesInFlight = count;
+	renderer.currentFrame = 0;
 }
 
-bool LoadTexture(const char* filePath,Image* outImage)
+uint32_t GetFramesInFlight(void)
+{
+	return renderer.framesInFlight;
+}
+
+//Safe to call from any thread; on failure the reason is left in SDL_GetError(), which is thread-local.
+static SDL_Surface* DecodeTexture(const char* filePath)
 {
 	SDL_Surface* surface = IMG_Load(filePath);
 	if(!surface)
 	{
-		SetError(IMG_GetError());
-		return false;
+		return NULL;
 	}
 	SDL_Surface* convertedSurface = SDL_ConvertSurfaceFormat(surface,SDL_PIXELFORMAT_RGBA32,0);
 	SDL_FreeSurface(surface);
-	if(!convertedSurface)
+	return convertedSurface;
+}
+
+//Texels are tightly packed RGBA32 rows; they are copied into the staging ring before this returns.
+static bool CreateTexture(uint32_t width,uint32_t height,const uint8_t* texels,Image* outImage)
+{
+	ImageData newImageData = {0};
+	uint32_t queueFamilyIndices[] = {renderer.graphicsQueueFamilyIndex,renderer.transferQueueFamilyIndex};
+	uint32_t queueFamilyIndexCount = (renderer.transferQueueFamilyIndex != renderer.graphicsQueueFamilyIndex) ? 2 : 1;
+	if(!CreateRenderingImage(renderer.device,&renderer.memoryAllocator,(VkExtent2D){width,height},VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,queueFamilyIndexCount,queueFamilyIndices,&newImageData.image))
 	{
-		SetError(IMG_GetError());
 		return false;
 	}
-
-	ImageData newImageData = {0};
-	if(!CreateRenderingImage(renderer.device,renderer.physicalDevice,(VkExtent2D){convertedSurface->w,convertedSurface->h},VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,& newImageData.image))
+	if(renderer.imageCount >= renderer.textureCapacity && !GrowTextureDescriptorSet(renderer.textureCapacity * 2))
 	{
-		SDL_FreeSurface(convertedSurface);
+		DestroyRenderingImage(renderer.device,newImageData.image);
 		return false;
 	}
-	if(!FillImageTexels(renderer.device,renderer.physicalDevice,renderer.renderingCommandPool,renderer.graphicsQueue,convertedSurface->pixels,newImageData.image))
+	ImageData* tmp = realloc(renderer.images,(renderer.imageCount + 1) * sizeof(*tmp));
+	if(!tmp)
 	{
 		DestroyRenderingImage(renderer.device,newImageData.image);
-		SDL_FreeSurface(convertedSurface);
+		SetError("Couldn't allocate %zu bytes of memory.",sizeof(*tmp));
 		return false;
 	}
-	SDL_FreeSurface(convertedSurface);
+	renderer.images = tmp;
+	CountFrameHeapAllocation();
 
-	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-		.descriptorPool = renderer.descriptorPool,
-		.descriptorSetCount = 1,
-		.pSetLayouts = &renderer.materialDescriptorSetLayout
-	};
-	VkResult result = vkAllocateDescriptorSets(renderer.device,&descriptorSetAllocateInfo,&newImageData.descriptorSet);
-	if(result != VK_SUCCESS)
+	//Queued last, because an image already referenced by a batch couldn't be destroyed on a later failure.
+	if(!QueueImageUpload(&renderer.uploadQueue,texels,newImageData.image,&newImageData.uploadValue))
 	{
 		DestroyRenderingImage(renderer.device,newImageData.image);
 		return false;
@@ -843,29 +2232,18 @@ bool LoadTexture(const char* filePath,Image* outImage)
 	VkWriteDescriptorSet writeDescriptorSet = {
 		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 		.descriptorCount = 1,
-		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		.dstArrayElement = 0,
-		.dstBinding = 0,
-		.dstSet = newImageData.descriptorSet,
+		.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		.dstArrayElement = (uint32_t)renderer.imageCount,
+		.dstBinding = 1,
+		.dstSet = renderer.textureDescriptorSet,
 		.pImageInfo = &(VkDescriptorImageInfo){
 			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			.imageView = newImageData.image.imageView,
-			.sampler = renderer.sampler
+			.imageView = newImageData.image.imageView
 		},
 		.pBufferInfo = NULL,
 		.pTexelBufferView = NULL
 	};
 	vkUpdateDescriptorSets(renderer.device,1,&writeDescriptorSet,0,NULL);
-
-	ImageData* tmp = realloc(renderer.images,(renderer.imageCount + 1) * sizeof(*tmp));
-	if(!tmp)
-	{
-		vkFreeDescriptorSets(renderer.device,renderer.descriptorPool,1,&newImageData.descriptorSet);
-		DestroyRenderingImage(renderer.device,newImageData.image);
-		SetError("Couldn't allocate %zu bytes of memory.",sizeof(*tmp));
-		return false;
-	}
-	renderer.images = tmp;
 	++renderer.imageCount;
 	renderer.images[renderer.imageCount - 1] = newImageData;
 	if(outImage)
@@ -875,20 +2253,382 @@ bool LoadTexture(const char* filePath,Image* outImage)
 	return true;
 }
 
-bool RenderQuad(const QuadRenderCommand* cmd)
+//Takes ownership of the surface, which has to be in SDL_PIXELFORMAT_RGBA32.
+static bool CreateTextureFromSurface(SDL_Surface* convertedSurface,Image* outImage)
+{
+	bool result = CreateTexture((uint32_t)convertedSurface->w,(uint32_t)convertedSurface->h,convertedSurface->pixels,outImage);
+	SDL_FreeSurface(convertedSurface);
+	return result;
+}
+
+static const TexturePackEntry* FindPackedTexture(const char* name)
 {
-	if((renderer.quadRenderCommandCount + 1) > renderer.quadRenderCommandCapacity)
+	for(uint32_t i = 0;i < renderer.texturePackEntryCount;++i)
 	{
-		QuadRenderCommand* tmp = realloc(renderer.quadRenderCommands,(renderer.quadRenderCommandCapacity + 256) * sizeof(*tmp));
-		if(!tmp)
+		if(strncmp(renderer.texturePackEntries[i].name,name,TEXTURE_PACK_NAME_SIZE) == 0)
+		{
+			return &renderer.texturePackEntries[i];
+		}
+	}
+	return NULL;
+}
+
+static bool CreatePackedTexture(const TexturePackEntry* entry,Image* outImage)
+{
+	return CreateTexture(entry->width,entry->height,(const uint8_t*)renderer.texturePack.data + entry->offset,outImage);
+}
+
+bool LoadTexturePack(const char* filePath)
+{
+	UnloadTexturePack();
+	MappedFile texturePack = {0};
+	if(!MapFile(filePath,&texturePack))
+	{
+		return false;
+	}
+	TexturePackHeader header = {0};
+	if(texturePack.size >= sizeof(header))
+	{
+		memcpy(&header,texturePack.data,sizeof(header));
+	}
+	if(header.magic != TEXTURE_PACK_MAGIC || header.version != TEXTURE_PACK_VERSION ||
+	   (texturePack.size - sizeof(header)) / sizeof(TexturePackEntry) < header.entryCount)
+	{
+		UnmapFile(&texturePack);
+		SetError("File \"%s\" isn't a valid texture pack.",filePath);
+		return false;
+	}
+	const TexturePackEntry* entries = (const TexturePackEntry*)((const uint8_t*)texturePack.data + sizeof(header));
+	for(uint32_t i = 0;i < header.entryCount;++i)
+	{
+		if(entries[i].offset > texturePack.size || entries[i].size > texturePack.size - entries[i].offset ||
+		   entries[i].size != (uint64_t)entries[i].width * entries[i].height * 4 || entries[i].name[TEXTURE_PACK_NAME_SIZE - 1] != '\0')
 		{
-			SetError("Couldn't allocate %zu bytes of memory.",256 * sizeof(*tmp));
+			UnmapFile(&texturePack);
+			SetError("Texture pack \"%s\" has a corrupted entry %u.",filePath,i);
 			return false;
 		}
-		renderer.quadRenderCommands = tmp;
-		renderer.quadRenderCommandCapacity += 256;
 	}
-	++renderer.quadRenderCommandCount;
-	renderer.quadRenderCommands[renderer.quadRenderCommandCount - 1] = *cmd;
+	renderer.texturePack = texturePack;
+	renderer.texturePackEntries = entries;
+	renderer.texturePackEntryCount = header.entryCount;
+	return true;
+}
+
+void UnloadTexturePack(void)
+{
+	UnmapFile(&renderer.texturePack);
+	renderer.texturePackEntries = NULL;
+	renderer.texturePackEntryCount = 0;
+}
+
+bool LoadTexture(const char* filePath,Image* outImage)
+{
+	const TexturePackEntry* entry = FindPackedTexture(filePath);
+	if(entry)
+	{
+		return CreatePackedTexture(entry,outImage);
+	}
+	SDL_Surface* surface = DecodeTexture(filePath);
+	if(!surface)
+	{
+		SetError("%s",SDL_GetError());
+		return false;
+	}
+	return CreateTextureFromSurface(surface,outImage);
+}
+
+static void DecodeTextureRange(void* userData,size_t begin,size_t end)
+{
+	TextureDecodeBatch* batch = userData;
+	for(size_t index = begin;index < end && !SDL_AtomicGet(&batch->cancelled);++index)
+	{
+		if(FindPackedTexture(batch->filePaths[index]))
+		{
+			continue;
+		}
+		SDL_Surface* surface = DecodeTexture(batch->filePaths[index]);
+		if(!surface)
+		{
+			snprintf(batch->errorMessages[index],sizeof(batch->errorMessages[index]),"%s: %s",batch->filePaths[index],SDL_GetError());
+		}
+
+		SDL_LockMutex(batch->mutex);
+		batch->surfaces[index] = surface;
+		batch->decoded[index] = true;
+		SDL_CondBroadcast(batch->condition);
+		SDL_UnlockMutex(batch->mutex);
+	}
+}
+
+bool LoadTextures(const char* const* filePaths,size_t count,Image* outImages)
+{
+	if(count == 0)
+	{
+		return true;
+	}
+	TextureDecodeBatch batch = {
+		.filePaths = filePaths,
+		.count = count
+	};
+	batch.surfaces = calloc(count,sizeof(*batch.surfaces));
+	batch.decoded = calloc(count,sizeof(*batch.decoded));
+	batch.errorMessages = malloc(count * sizeof(*batch.errorMessages));
+	batch.mutex = SDL_CreateMutex();
+	batch.condition = SDL_CreateCond();
+	if(!batch.surfaces || !batch.decoded || !batch.errorMessages || !batch.mutex || !batch.condition)
+	{
+		SDL_DestroyCond(batch.condition);
+		SDL_DestroyMutex(batch.mutex);
+		free(batch.errorMessages);
+		free(batch.decoded);
+		free(batch.surfaces);
+		SetError("Couldn't allocate resources for loading %zu textures.",count);
+		return false;
+	}
+
+	//The main thread stays busy creating images and filling the staging ring, so the decoding is left to the job workers.
+	//Without any workers nobody would decode while it waits, so everything is decoded up front instead.
+	JobCounter decodeCounter = {0};
+	ParallelFor(count,1,DecodeTextureRange,&batch,&decodeCounter);
+	if(GetJobWorkerCount() == 0)
+	{
+		WaitForJobs(&decodeCounter);
+	}
+
+	//Textures are created in order as soon as each one is decoded, overlapping the upload work with the remaining decodes.
+	bool success = true;
+	for(size_t i = 0;i < count && success;++i)
+	{
+		const TexturePackEntry* entry = FindPackedTexture(filePaths[i]);
+		if(entry)
+		{
+			success = CreatePackedTexture(entry,&outImages[i]);
+			continue;
+		}
+		SDL_LockMutex(batch.mutex);
+		while(!batch.decoded[i])
+		{
+			SDL_CondWait(batch.condition,batch.mutex);
+		}
+		SDL_Surface* surface = batch.surfaces[i];
+		batch.surfaces[i] = NULL;
+		SDL_UnlockMutex(batch.mutex);
+
+		if(!surface)
+		{
+			SetError("%s",batch.errorMessages[i]);
+			success = false;
+		}
+		else if(!CreateTextureFromSurface(surface,&outImages[i]))
+		{
+			success = false;
+		}
+	}
+
+	SDL_AtomicSet(&batch.cancelled,1);
+	WaitForJobs(&decodeCounter);
+	for(size_t i = 0;i < count;++i)
+	{
+		SDL_FreeSurface(batch.surfaces[i]);
+	}
+	SDL_DestroyCond(batch.condition);
+	SDL_DestroyMutex(batch.mutex);
+	free(batch.errorMessages);
+	free(batch.decoded);
+	free(batch.surfaces);
+	return success;
+}
+
+//Growing leaves the old arrays behind in the frame arena; that waste is gone once the arena is begun again.
+static bool ReserveQuadInstances(size_t count)
+{
+	size_t capacity = (renderer.quadInstanceCapacity > 0) ? renderer.quadInstanceCapacity : INITIAL_QUAD_INSTANCE_CAPACITY;
+	while(capacity < (renderer.quadInstanceCount + count))
+	{
+		capacity *= 2;
+	}
+	if(capacity == renderer.quadInstanceCapacity)
+	{
+		return true;
+	}
+	QuadInstance* instances = AllocateFrameMemory(capacity * sizeof(QuadInstance),_Alignof(QuadInstance));
+	uint64_t* keys = AllocateFrameMemory(capacity * sizeof(uint64_t),_Alignof(uint64_t));
+	if(!instances || !keys)
+	{
+		return false;
+	}
+	if(renderer.quadInstanceCount > 0)
+	{
+		memcpy(instances,renderer.quadInstances,renderer.quadInstanceCount * sizeof(QuadInstance));
+		memcpy(keys,renderer.quadSortKeys,renderer.quadInstanceCount * sizeof(uint64_t));
+	}
+	renderer.quadInstances = instances;
+	renderer.quadSortKeys = keys;
+	renderer.quadInstanceCapacity = capacity;
+	return true;
+}
+
+//Image indices are below MAX_TEXTURE_COUNT, so they always fit into the texture bits.
+static uint64_t MakeQuadSortKey(uint8_t layer,Image image,size_t submissionIndex)
+{
+	return ((uint64_t)layer << SORT_KEY_LAYER_SHIFT) | ((uint64_t)image << SORT_KEY_TEXTURE_SHIFT) | ((uint64_t)submissionIndex & SORT_KEY_DEPTH_MASK);
+}
+
+bool RenderQuad(const QuadRenderCommand* cmd)
+{
+	if(!ReserveQuadInstances(1))
+	{
+		return false;
+	}
+	renderer.quadSortKeys[renderer.quadInstanceCount] = MakeQuadSortKey(cmd->layer,cmd->image,renderer.quadInstanceCount);
+	renderer.quadInstances[renderer.quadInstanceCount] = (QuadInstance){
+		.position = cmd->position,
+		.size = cmd->size,
+		.image = (uint32_t)cmd->image
+	};
+	++renderer.quadInstanceCount;
+	return true;
+}
+
+bool RenderQuadBatch(const Vec2* positions,size_t count,Vec2 size,Image image,uint8_t layer)
+{
+	if(!ReserveQuadInstances(count))
+	{
+		return false;
+	}
+	QuadInstance* instances = &renderer.quadInstances[renderer.quadInstanceCount];
+	uint64_t* keys = &renderer.quadSortKeys[renderer.quadInstanceCount];
+	for(size_t i = 0;i < count;++i)
+	{
+		keys[i] = MakeQuadSortKey(layer,image,renderer.quadInstanceCount + i);
+		instances[i] = (QuadInstance){
+			.position = positions[i],
+			.size = size,
+			.image = (uint32_t)image
+		};
+	}
+	renderer.quadInstanceCount += count;
+	return true;
+}
+
+static void MarkStaticQuadDirty(StaticQuad quad)
+{
+	if(renderer.staticQuadDirtyBegin == renderer.staticQuadDirtyEnd)
+	{
+		renderer.staticQuadDirtyBegin = quad;
+		renderer.staticQuadDirtyEnd = quad;
+	}
+	if(quad < renderer.staticQuadDirtyBegin)
+	{
+		renderer.staticQuadDirtyBegin = quad;
+	}
+	if(quad >= renderer.staticQuadDirtyEnd)
+	{
+		renderer.staticQuadDirtyEnd = (size_t)quad + 1;
+	}
+	renderer.staticQuadFlags[quad] |= STATIC_QUAD_DIRTY;
+}
+
+bool AddStaticQuad(const QuadRenderCommand* cmd,StaticQuad* outQuad)
+{
+	StaticQuad quad = 0;
+	if(renderer.freeStaticQuadCount > 0)
+	{
+		quad = renderer.freeStaticQuads[--renderer.freeStaticQuadCount];
+	}
+	else
+	{
+		if(renderer.staticQuadCount == renderer.staticQuadCapacity)
+		{
+			size_t capacity = (renderer.staticQuadCapacity > 0) ? renderer.staticQuadCapacity * 2 : INITIAL_STATIC_QUAD_CAPACITY;
+			void** const arrays[] = {(void**)&renderer.staticQuads,(void**)&renderer.staticQuadFlags,(void**)&renderer.freeStaticQuads};
+			const size_t elementSizes[] = {sizeof(QuadInstance),sizeof(uint8_t),sizeof(StaticQuad)};
+			if(!ResizeArrays(arrays,elementSizes,sizeof(arrays) / sizeof(arrays[0]),capacity))
+			{
+				return false;
+			}
+			renderer.staticQuadCapacity = capacity;
+		}
+		quad = (StaticQuad)renderer.staticQuadCount++;
+	}
+	renderer.staticQuads[quad] = (QuadInstance){
+		.position = cmd->position,
+		.size = cmd->size,
+		.image = (uint32_t)cmd->image
+	};
+	renderer.staticQuadFlags[quad] = STATIC_QUAD_USED | STATIC_QUAD_VISIBLE;
+	MarkStaticQuadDirty(quad);
+	*outQuad = quad;
 	return true;
+}
+
+static bool IsStaticQuadUsed(StaticQuad quad)
+{
+	return quad < renderer.staticQuadCount && (renderer.staticQuadFlags[quad] & STATIC_QUAD_USED);
+}
+
+void SetStaticQuadVisible(StaticQuad quad,bool visible)
+{
+	if(!IsStaticQuadUsed(quad))
+	{
+		return;
+	}
+	uint8_t flags = renderer.staticQuadFlags[quad];
+	if(((flags & STATIC_QUAD_VISIBLE) != 0) == visible)
+	{
+		return;
+	}
+	renderer.staticQuadFlags[quad] = visible ? (flags | STATIC_QUAD_VISIBLE) : (flags & ~STATIC_QUAD_VISIBLE);
+	MarkStaticQuadDirty(quad);
+}
+
+void RemoveStaticQuad(StaticQuad quad)
+{
+	//A removed handle would otherwise end up in the free list twice.
+	if(!IsStaticQuadUsed(quad))
+	{
+		return;
+	}
+	renderer.staticQuadFlags[quad] = 0;
+	MarkStaticQuadDirty(quad);
+	renderer.freeStaticQuads[renderer.freeStaticQuadCount++] = quad;
+}
+
+bool IsTextureReady(Image image)
+{
+	return image < renderer.imageCount && IsUploadComplete(&renderer.uploadQueue,renderer.images[image].uploadValue);
+}
+
+void GetRenderStatistics(RenderStatistics* outStatistics)
+{
+	*outStatistics = renderer.statistics;
+	MemoryStatistics memoryStatistics = {0};
+	GetMemoryStatistics(&renderer.memoryAllocator,&memoryStatistics);
+	outStatistics->memoryBlockCount = memoryStatistics.blockCount;
+	outStatistics->memoryAllocationCount = memoryStatistics.allocationCount;
+	outStatistics->memoryReservedBytes = memoryStatistics.reservedBytes;
+	outStatistics->memoryUsedBytes = memoryStatistics.usedBytes;
+}
+
+void GetGpuProfile(GpuProfile* outProfile)
+{
+	*outProfile = (GpuProfile){
+		.timingCount = (renderer.gpuProfiler.resultCount < MAX_GPU_TIMINGS) ? renderer.gpuProfiler.resultCount : MAX_GPU_TIMINGS,
+		.hasPipelineStatistics = renderer.gpuProfiler.hasStatistics,
+		.inputAssemblyPrimitives = renderer.gpuProfiler.statistics.inputAssemblyPrimitives,
+		.vertexShaderInvocations = renderer.gpuProfiler.statistics.vertexShaderInvocations,
+		.clippingPrimitives = renderer.gpuProfiler.statistics.clippingPrimitives,
+		.fragmentShaderInvocations = renderer.gpuProfiler.statistics.fragmentShaderInvocations
+	};
+	for(size_t i = 0;i < outProfile->timingCount;++i)
+	{
+		outProfile->timings[i] = (GpuTiming){
+			.name = renderer.gpuProfiler.results[i].name,
+			.depth = renderer.gpuProfiler.results[i].depth,
+			.milliseconds = renderer.gpuProfiler.results[i].milliseconds
+		};
+	}
+	outProfile->uploadMilliseconds = renderer.uploadQueue.gpuMilliseconds;
+	outProfile->uploadBatchCount = renderer.uploadQueue.timedBatchCount;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define RENDERER_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include "math.h"
 
@@ -12,18 +13,89 @@ typedef struct Vertex
 } Vertex;
 
 typedef size_t Image;
+//Quads are drawn in layer order; within a layer, quads that share an image are drawn together in the order they were queued.
 typedef struct QuadRenderCommand
 {
 	Vec2 position;
 	Vec2 size;
 	Image image;
+	uint8_t layer;
 } QuadRenderCommand;
 
+//Handle of a quad that stays on the GPU until it's removed.
+typedef uint32_t StaticQuad;
+
+typedef struct RenderStatistics
+{
+	size_t drawCallCount;
+	size_t instanceCount;
+	//Runs of neighbouring queued quads that share blend mode, pipeline and texture, in submission order and after sorting; the difference is what sorting saved.
+	//Draw calls only split where the pipeline changes and there's a single pipeline, so fewer runs mean fewer state changes rather than fewer draw calls.
+	size_t unsortedRunCount;
+	size_t sortedRunCount;
+	//Static quads copied to the GPU this frame; zero while none of them changed.
+	size_t staticQuadUploadCount;
+	size_t memoryBlockCount;
+	size_t memoryAllocationCount;
+	uint64_t memoryReservedBytes;
+	uint64_t memoryUsedBytes;
+} RenderStatistics;
+
+#define MAX_GPU_TIMINGS 16
+
+typedef struct GpuTiming
+{
+	//Static string naming the scope; depth is how many scopes enclose it.
+	const char* name;
+	uint32_t depth;
+	double milliseconds;
+} GpuTiming;
+
+//Measured on the GPU with timestamp queries, so it lags behind the CPU by the frames in flight.
+typedef struct GpuProfile
+{
+	GpuTiming timings[MAX_GPU_TIMINGS];
+	size_t timingCount;
+	//Texture uploads on the transfer queue, summed over every upload batch the GPU finished so far.
+	double uploadMilliseconds;
+	uint32_t uploadBatchCount;
+	//Only valid when the device supports pipeline statistics queries.
+	bool hasPipelineStatistics;
+	uint64_t inputAssemblyPrimitives;
+	uint64_t vertexShaderInvocations;
+	uint64_t clippingPrimitives;
+	uint64_t fragmentShaderInvocations;
+} GpuProfile;
+
 void InitRenderer(void);
 void TermRenderer(void);
 void BeginRendering(void);
 void EndRendering(void);
+//Trades input latency for CPU/GPU overlap; count is clamped to [1, 3]. Waits for the GPU, so it may be called between any two frames.
+void SetFramesInFlight(uint32_t count);
+uint32_t GetFramesInFlight(void);
+//While a pack is loaded, textures whose path matches a packed name are read from it instead of being decoded.
+bool LoadTexturePack(const char* filePath);
+void UnloadTexturePack(void);
 bool LoadTexture(const char* filePath,Image* outImage);
+//Decodes the files on worker threads while the calling thread creates the textures; outImages must have room for count images.
+//Textures are created in order and stop at the first failure; the ones before it stay loaded and valid in outImages,
+//like textures from separate LoadTexture calls, because their uploads may already be on the GPU.
+bool LoadTextures(const char* const* filePaths,size_t count,Image* outImages);
 bool RenderQuad(const QuadRenderCommand* cmd);
+//Queues count quads that share size and image; the instance array grows at most once per call.
+bool RenderQuadBatch(const Vec2* positions,size_t count,Vec2 size,Image image,uint8_t layer);
+//Static quads are drawn every frame below all queued quads, in no particular order among themselves, and their layer is ignored.
+//Only the ones that were added, toggled or removed since the last frame are uploaded again.
+bool AddStaticQuad(const QuadRenderCommand* cmd,StaticQuad* outQuad);
+void SetStaticQuadVisible(StaticQuad quad,bool visible);
+//The handle may be returned by a later AddStaticQuad; handles that aren't in use are ignored, here and by SetStaticQuadVisible.
+void RemoveStaticQuad(StaticQuad quad);
+//Textures may be drawn right after loading (the GPU waits for their upload); this only tells whether the upload already finished.
+bool IsTextureReady(Image image);
+void GetRenderStatistics(RenderStatistics* outStatistics);
+void GetGpuProfile(GpuProfile* outProfile);
+//Only works without a window; the next EndRendering waits for its frame and writes it as PNG if the path ends with ".png" or as binary PPM otherwise.
+bool RequestFrameCapture(const char* filePath);
 
 #endif
\ No newline at end of file
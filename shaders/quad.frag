@@ -0,0 +1,15 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 passTextureCoords;
+layout(location = 1) flat in uint passImage;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 1,binding = 0) uniform sampler textureSampler;
+layout(set = 1,binding = 1) uniform texture2D textures[];
+
+void main(void)
+{
+	outColor = texture(sampler2D(textures[nonuniformEXT(passImage)],textureSampler),passTextureCoords);
+}
\ No newline at end of file
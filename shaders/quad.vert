@@ -0,0 +1,22 @@
+#version 450
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 textureCoords;
+layout(location = 2) in vec2 instancePosition;
+layout(location = 3) in vec2 instanceSize;
+layout(location = 4) in uint instanceImage;
+
+layout(location = 0) out vec2 passTextureCoords;
+layout(location = 1) flat out uint passImage;
+
+layout(set = 0,binding = 0) uniform TransformationMatrix
+{
+	mat4 matrix;
+};
+
+void main(void)
+{
+	gl_Position = matrix * vec4(instancePosition + position * instanceSize,0.0,1.0);
+	passTextureCoords = textureCoords;
+	passImage = instanceImage;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef TEXTURE_PACK_H
+#define TEXTURE_PACK_H
+
+#include <stdint.h>
+
+//Layout: header, entryCount entries, then RGBA32 texel blobs, each starting at a multiple of TEXTURE_PACK_ALIGNMENT.
+#define TEXTURE_PACK_MAGIC 0x4B505443u
+#define TEXTURE_PACK_VERSION 1u
+#define TEXTURE_PACK_ALIGNMENT 64u
+#define TEXTURE_PACK_NAME_SIZE 64
+
+typedef struct TexturePackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+} TexturePackHeader;
+
+typedef struct TexturePackEntry
+{
+	char name[TEXTURE_PACK_NAME_SIZE];
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+} TexturePackEntry;
+
+#endif
\ No newline at end of file
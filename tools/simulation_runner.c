@@ -0,0 +1,88 @@
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "game.h"
+
+#define DEFAULT_STEP_COUNT 10000000ull
+#define DEFAULT_TICK_RATE 60
+
+static double GetSeconds(void)
+{
+	struct timespec time = {0};
+	timespec_get(&time,TIME_UTC);
+	return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+//Keeps the paddle under the ball and starts a new round whenever one ends, so that every step exercises the gameplay code.
+//Right before a hit the paddle aims off-center, so it is still moving and gives the ball some sideways speed.
+static GameInput GetAutopilotInput(const Game* game)
+{
+	if(game->state != GAME_STATE_PLAY)
+	{
+		return (GameInput){.start = true};
+	}
+	float ballCenter = game->ball.position.x + game->ball.size.x / 2;
+	float playerCenter = game->player.position.x + game->player.size.x / 2;
+	if(game->ballVelocity.y > 0 && (game->player.position.y - game->ball.position.y) < 32)
+	{
+		playerCenter += (ballCenter < GAME_WIDTH / 2) ? -48 : 48;
+	}
+	return (GameInput){
+		.moveLeft = ballCenter < playerCenter - 8,
+		.moveRight = ballCenter > playerCenter + 8
+	};
+}
+
+//Usage: SimulationRunner [step count] [seed] [tick rate] [storm ball count] [brick columns] [brick rows]
+//Steps the game without SDL or the renderer and reports how many steps per second the gameplay code manages.
+//Collisions are swept, so low tick rates give fewer, larger steps without the ball passing through anything.
+int main(int argc,char** argv)
+{
+	unsigned long long stepCount = (argc > 1) ? strtoull(argv[1],NULL,10) : DEFAULT_STEP_COUNT;
+	uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2],NULL,10) : 1;
+	unsigned long tickRate = (argc > 3) ? strtoul(argv[3],NULL,10) : DEFAULT_TICK_RATE;
+	size_t stormBallCount = (argc > 4) ? (size_t)strtoull(argv[4],NULL,10) : 0;
+	uint32_t brickColumns = (argc > 5) ? (uint32_t)strtoul(argv[5],NULL,10) : DEFAULT_BRICK_COLUMNS;
+	uint32_t brickRows = (argc > 6) ? (uint32_t)strtoul(argv[6],NULL,10) : DEFAULT_BRICK_ROWS;
+	if(stepCount == 0 || tickRate == 0)
+	{
+		fprintf(stderr,"Usage: %s [step count] [seed] [tick rate] [storm ball count] [brick columns] [brick rows]\n",argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	float stepDuration = 1.0f / (float)tickRate;
+	Game game = {0};
+	CreateGame(&game,seed,brickColumns,brickRows);
+	//Static, since a full storm is a few megabytes.
+	static BallStorm storm;
+	CreateBallStorm(&storm,&game,stormBallCount,seed);
+	unsigned long long wonCount = 0;
+	unsigned long long lostCount = 0;
+	double startTime = GetSeconds();
+	for(unsigned long long i = 0;i < stepCount;++i)
+	{
+		GameState oldState = game.state;
+		GameInput input = GetAutopilotInput(&game);
+		StepGame(&game,&input,stepDuration);
+		if(game.state == GAME_STATE_PLAY)
+		{
+			StepBallStorm(&storm,&game,stepDuration);
+		}
+		if(game.state != oldState)
+		{
+			wonCount += game.state == GAME_STATE_WON;
+			lostCount += game.state == GAME_STATE_LOST;
+		}
+	}
+	double seconds = GetSeconds() - startTime;
+
+	//Printing the final state keeps the compiler from optimizing the loop away and makes runs with the same seed comparable.
+	printf("Simulated %llu steps in %.3f s: %.2f million steps/s, %.1f ns/step.\n",stepCount,seconds,(double)stepCount / seconds / 1e6,seconds * 1e9 / (double)stepCount);
+	printf("Rounds won: %llu, lost: %llu, final ball position: (%.3f, %.3f).\n",wonCount,lostCount,(double)game.ball.position.x,(double)game.ball.position.y);
+	if(storm.count > 0)
+	{
+		printf("Storm of %zu balls, first ball position: (%.3f, %.3f).\n",storm.count,(double)storm.positions[0].x,(double)storm.positions[0].y);
+	}
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "texture_pack.h"
+
+//Usage: TexturePacker <output pack> <texture>...
+//Textures are stored under the exact name given on the command line, which is what the game passes to LoadTexture.
+int main(int argc,char** argv)
+{
+	if(argc < 3)
+	{
+		fprintf(stderr,"Usage: %s <output pack> <texture>...\n",argv[0]);
+		return EXIT_FAILURE;
+	}
+	uint32_t entryCount = (uint32_t)(argc - 2);
+	TexturePackEntry* entries = calloc(entryCount,sizeof(*entries));
+	SDL_Surface** surfaces = calloc(entryCount,sizeof(*surfaces));
+	if(!entries || !surfaces)
+	{
+		fprintf(stderr,"Couldn't allocate memory for %u textures.\n",entryCount);
+		return EXIT_FAILURE;
+	}
+
+	uint64_t offset = sizeof(TexturePackHeader) + entryCount * sizeof(TexturePackEntry);
+	for(uint32_t i = 0;i < entryCount;++i)
+	{
+		const char* name = argv[i + 2];
+		if(strlen(name) >= TEXTURE_PACK_NAME_SIZE)
+		{
+			fprintf(stderr,"Texture name \"%s\" is longer than %d characters.\n",name,TEXTURE_PACK_NAME_SIZE - 1);
+			return EXIT_FAILURE;
+		}
+		SDL_Surface* surface = IMG_Load(name);
+		if(!surface)
+		{
+			fprintf(stderr,"Couldn't load \"%s\": %s\n",name,IMG_GetError());
+			return EXIT_FAILURE;
+		}
+		surfaces[i] = SDL_ConvertSurfaceFormat(surface,SDL_PIXELFORMAT_RGBA32,0);
+		SDL_FreeSurface(surface);
+		if(!surfaces[i])
+		{
+			fprintf(stderr,"Couldn't convert \"%s\": %s\n",name,SDL_GetError());
+			return EXIT_FAILURE;
+		}
+
+		offset = (offset + TEXTURE_PACK_ALIGNMENT - 1) & ~(uint64_t)(TEXTURE_PACK_ALIGNMENT - 1);
+		strcpy(entries[i].name,name);
+		entries[i].width = (uint32_t)surfaces[i]->w;
+		entries[i].height = (uint32_t)surfaces[i]->h;
+		entries[i].offset = offset;
+		entries[i].size = (uint64_t)entries[i].width * entries[i].height * 4;
+		offset += entries[i].size;
+	}
+
+	FILE* file = fopen(argv[1],"wb");
+	if(!file)
+	{
+		fprintf(stderr,"Couldn't open \"%s\" for writing.\n",argv[1]);
+		return EXIT_FAILURE;
+	}
+	TexturePackHeader header = {
+		.magic = TEXTURE_PACK_MAGIC,
+		.version = TEXTURE_PACK_VERSION,
+		.entryCount = entryCount
+	};
+	bool written = fwrite(&header,sizeof(header),1,file) == 1 && fwrite(entries,sizeof(*entries),entryCount,file) == entryCount;
+	uint64_t position = sizeof(header) + entryCount * sizeof(*entries);
+	static const uint8_t padding[TEXTURE_PACK_ALIGNMENT] = {0};
+	for(uint32_t i = 0;i < entryCount && written;++i)
+	{
+		written = fwrite(padding,1,(size_t)(entries[i].offset - position),file) == entries[i].offset - position;
+		//Rows are written one by one because SDL may pad the surface pitch.
+		const uint8_t* pixels = surfaces[i]->pixels;
+		size_t rowSize = (size_t)entries[i].width * 4;
+		for(uint32_t y = 0;y < entries[i].height && written;++y)
+		{
+			written = fwrite(pixels + (size_t)y * surfaces[i]->pitch,1,rowSize,file) == rowSize;
+		}
+		position = entries[i].offset + entries[i].size;
+	}
+	if(fclose(file) != 0 || !written)
+	{
+		fprintf(stderr,"Couldn't write \"%s\".\n",argv[1]);
+		remove(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	for(uint32_t i = 0;i < entryCount;++i)
+	{
+		SDL_FreeSurface(surfaces[i]);
+	}
+	free(surfaces);
+	free(entries);
+	printf("Packed %u textures into \"%s\" (%llu bytes).\n",entryCount,argv[1],(unsigned long long)position);
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -1,5 +1,38 @@
 #include "vulkan.h"
 
+static PFN_vkCmdBeginDebugUtilsLabelEXT cmdBeginDebugUtilsLabel;
+static PFN_vkCmdEndDebugUtilsLabelEXT cmdEndDebugUtilsLabel;
+
+void LoadDebugUtilsFunctions(VkInstance instance)
+{
+	cmdBeginDebugUtilsLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetInstanceProcAddr(instance,"vkCmdBeginDebugUtilsLabelEXT");
+	cmdEndDebugUtilsLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetInstanceProcAddr(instance,"vkCmdEndDebugUtilsLabelEXT");
+	if(!cmdBeginDebugUtilsLabel || !cmdEndDebugUtilsLabel)
+	{
+		cmdBeginDebugUtilsLabel = NULL;
+		cmdEndDebugUtilsLabel = NULL;
+	}
+}
+
+void BeginDebugLabel(VkCommandBuffer commandBuffer,const char* name)
+{
+	if(cmdBeginDebugUtilsLabel)
+	{
+		cmdBeginDebugUtilsLabel(commandBuffer,&(VkDebugUtilsLabelEXT){
+			.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+			.pLabelName = name
+		});
+	}
+}
+
+void EndDebugLabel(VkCommandBuffer commandBuffer)
+{
+	if(cmdEndDebugUtilsLabel)
+	{
+		cmdEndDebugUtilsLabel(commandBuffer);
+	}
+}
+
 bool FindMemoryTypeIndex(VkPhysicalDevice physicalDevice,VkMemoryPropertyFlags memoryProperties,uint32_t memoryTypeBits,uint32_t* outMemoryTypeIndex)
 {
 	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties = {0};
@@ -18,6 +18,11 @@
 	while(0)
 
 
+//Loads the VK_EXT_debug_utils label functions; without the extension the label functions below do nothing.
+void LoadDebugUtilsFunctions(VkInstance instance);
+//Labels show up as named regions in external tools like RenderDoc or Nsight.
+void BeginDebugLabel(VkCommandBuffer commandBuffer,const char* name);
+void EndDebugLabel(VkCommandBuffer commandBuffer);
 bool FindMemoryTypeIndex(VkPhysicalDevice physicalDevice,VkMemoryPropertyFlags memoryProperties,uint32_t memoryTypeBits,uint32_t* outMemoryTypeIndex);
 const char* VkResultToString(VkResult result);
 
@@ -2,8 +2,10 @@
 
 #include <string.h>
 
-bool CreateRenderingBuffer(VkDevice device,VkPhysicalDevice physicalDevice,VkDeviceSize size,const void* data,VkMemoryPropertyFlags memoryProperties,VkBufferUsageFlags bufferUsage,RenderingBuffer* outBuffer)
+bool CreateRenderingBuffer(VkDevice device,MemoryAllocator* allocator,VkDeviceSize size,const void* data,VkMemoryPropertyFlags memoryProperties,VkBufferUsageFlags bufferUsage,MemoryStrategy strategy,RenderingBuffer* outBuffer)
 {
+	outBuffer->buffer = VK_NULL_HANDLE;
+	outBuffer->allocation = (MemoryAllocation){0};
 	outBuffer->size = size;
 	outBuffer->bufferUsage = bufferUsage;
 	outBuffer->memoryProperties = memoryProperties;
@@ -23,45 +25,28 @@ bool CreateRenderingBuffer(VkDevice device,VkPhysicalDevice physicalDevice,VkDev
 
 	VkMemoryRequirements memoryRequirements = {0};
 	vkGetBufferMemoryRequirements(device,outBuffer->buffer,&memoryRequirements);
-	uint32_t memoryTypeIndex = 0;
-	if(!FindMemoryTypeIndex(physicalDevice,outBuffer->memoryProperties,memoryRequirements.memoryTypeBits,&memoryTypeIndex))
+	if(!AllocateMemory(allocator,&memoryRequirements,outBuffer->memoryProperties,MEMORY_RESOURCE_LINEAR,strategy,&outBuffer->allocation))
 	{
 		DestroyRenderingBuffer(device,*outBuffer);
 		return false;
 	}
-
-	VkMemoryAllocateInfo memoryAllocateInfo = {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = memoryRequirements.size,
-		.memoryTypeIndex = memoryTypeIndex
-	};
-	result = vkAllocateMemory(device,&memoryAllocateInfo,NULL,&outBuffer->memory);
-	if(result != VK_SUCCESS)
-	{
-		DestroyRenderingBuffer(device,*outBuffer);
-		SetError("Function call vkAllocateMemory(device,&memoryAllocateInfo,NULL,&outBuffer->memory) returned %s.",VkResultToString(result));
-		return false;
-	}
-	result = vkBindBufferMemory(device,outBuffer->buffer,outBuffer->memory,0);
+	result = vkBindBufferMemory(device,outBuffer->buffer,outBuffer->allocation.memory,outBuffer->allocation.offset);
 	if(result != VK_SUCCESS)
 	{
 		DestroyRenderingBuffer(device,*outBuffer);
-		SetError("Function call vkBindBufferMemory(device,outBuffer->buffer,outBuffer->memory,0) returned %s.",VkResultToString(result));
+		SetError("Function call vkBindBufferMemory(device,outBuffer->buffer,outBuffer->allocation.memory,outBuffer->allocation.offset) returned %s.",VkResultToString(result));
 		return false;
 	}
 
 	if(data)
 	{
-		void* mappedData = NULL;
-		result = vkMapMemory(device,outBuffer->memory,0,VK_WHOLE_SIZE,0,&mappedData);
-		if(result != VK_SUCCESS)
+		if(!outBuffer->allocation.mappedData)
 		{
 			DestroyRenderingBuffer(device,*outBuffer);
-			SetError("Function call vkMapMemory(device,outBuffer->memory,0,VK_WHOLE_SIZE,0,&mappedData) returned %s.",VkResultToString(result));
+			SetError("Initial buffer data can only be written to host-visible memory.");
 			return false;
 		}
-		memcpy(mappedData,data,outBuffer->size);
-		vkUnmapMemory(device,outBuffer->memory);
+		memcpy(outBuffer->allocation.mappedData,data,outBuffer->size);
 	}
 	return true;
 }
@@ -69,5 +54,5 @@ bool CreateRenderingBuffer(VkDevice device,VkPhysicalDevice physicalDevice,VkDev
 void DestroyRenderingBuffer(VkDevice device,RenderingBuffer buffer)
 {
 	vkDestroyBuffer(device,buffer.buffer,NULL);
-	vkFreeMemory(device,buffer.memory,NULL);
+	FreeMemory(&buffer.allocation);
 }
\ No newline at end of file
@@ -3,17 +3,19 @@
 
 #include <stdbool.h>
 #include "vulkan.h"
+#include "vulkan_memory.h"
 
 typedef struct RenderingBuffer
 {
 	VkBuffer buffer;
-	VkDeviceMemory memory;
+	MemoryAllocation allocation;
 	VkDeviceSize size;
 	VkBufferUsageFlags bufferUsage;
 	VkMemoryPropertyFlags memoryProperties;
 } RenderingBuffer;
 
-bool CreateRenderingBuffer(VkDevice device,VkPhysicalDevice physicalDevice,VkDeviceSize size,const void* data,VkMemoryPropertyFlags memoryProperties,VkBufferUsageFlags bufferUsage,RenderingBuffer* outBuffer);
+//Short-lived buffers such as staging memory should use MEMORY_STRATEGY_LINEAR, everything else MEMORY_STRATEGY_FREE_LIST.
+bool CreateRenderingBuffer(VkDevice device,MemoryAllocator* allocator,VkDeviceSize size,const void* data,VkMemoryPropertyFlags memoryProperties,VkBufferUsageFlags bufferUsage,MemoryStrategy strategy,RenderingBuffer* outBuffer);
 void DestroyRenderingBuffer(VkDevice device,RenderingBuffer buffer);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "vulkan_descriptor.h"
+
+#include <stdlib.h>
+
+static bool CreateDescriptorPool(VkDevice device,DescriptorAllocator* allocator,uint32_t variableDescriptorCount)
+{
+	VkDescriptorPoolSize poolSizes[DESCRIPTOR_ALLOCATOR_MAX_POOL_SIZES] = {0};
+	for(uint32_t i = 0;i < allocator->poolSizeCount;++i)
+	{
+		poolSizes[i] = allocator->poolSizes[i];
+		poolSizes[i].descriptorCount *= allocator->setsPerPool;
+		//Variable-sized bindings can be bigger than the per-set template, so make sure that at least one such set fits.
+		if(poolSizes[i].descriptorCount < variableDescriptorCount + allocator->poolSizes[i].descriptorCount)
+		{
+			poolSizes[i].descriptorCount = variableDescriptorCount + allocator->poolSizes[i].descriptorCount;
+		}
+	}
+
+	VkDescriptorPool* tmp = realloc(allocator->pools,(allocator->poolCount + 1) * sizeof(*tmp));
+	if(!tmp)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",(allocator->poolCount + 1) * sizeof(*tmp));
+		return false;
+	}
+	allocator->pools = tmp;
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = allocator->poolFlags,
+		.maxSets = allocator->setsPerPool,
+		.poolSizeCount = allocator->poolSizeCount,
+		.pPoolSizes = poolSizes
+	};
+	VkResult result = vkCreateDescriptorPool(device,&descriptorPoolCreateInfo,NULL,&allocator->pools[allocator->poolCount]);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkCreateDescriptorPool(device,&descriptorPoolCreateInfo,NULL,&allocator->pools[allocator->poolCount]) returned %s.",VkResultToString(result));
+		return false;
+	}
+	++allocator->poolCount;
+	allocator->setsPerPool *= 2;
+	return true;
+}
+
+bool CreateDescriptorAllocator(VkDevice device,VkDescriptorPoolCreateFlags poolFlags,const VkDescriptorPoolSize* poolSizes,uint32_t poolSizeCount,uint32_t initialSetsPerPool,DescriptorAllocator* outAllocator)
+{
+	if(poolSizeCount > DESCRIPTOR_ALLOCATOR_MAX_POOL_SIZES)
+	{
+		SetError("Descriptor allocator supports at most %d pool sizes.",DESCRIPTOR_ALLOCATOR_MAX_POOL_SIZES);
+		return false;
+	}
+	*outAllocator = (DescriptorAllocator){
+		.poolFlags = poolFlags,
+		.poolSizeCount = poolSizeCount,
+		.setsPerPool = initialSetsPerPool
+	};
+	for(uint32_t i = 0;i < poolSizeCount;++i)
+	{
+		outAllocator->poolSizes[i] = poolSizes[i];
+	}
+	if(!CreateDescriptorPool(device,outAllocator,0))
+	{
+		DestroyDescriptorAllocator(device,outAllocator);
+		return false;
+	}
+	return true;
+}
+
+void DestroyDescriptorAllocator(VkDevice device,DescriptorAllocator* allocator)
+{
+	for(size_t i = 0;i < allocator->poolCount;++i)
+	{
+		vkDestroyDescriptorPool(device,allocator->pools[i],NULL);
+	}
+	free(allocator->pools);
+	*allocator = (DescriptorAllocator){0};
+}
+
+bool AllocateDescriptorSet(VkDevice device,DescriptorAllocator* allocator,VkDescriptorSetLayout layout,uint32_t variableDescriptorCount,VkDescriptorSet* outSet,VkDescriptorPool* outPool)
+{
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableDescriptorCountAllocateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+		.descriptorSetCount = 1,
+		.pDescriptorCounts = &variableDescriptorCount
+	};
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = variableDescriptorCount > 0 ? &variableDescriptorCountAllocateInfo : NULL,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout
+	};
+
+	//Sets freed back into older pools leave room there, so every pool is tried (newest first) before a bigger one is appended.
+	for(size_t i = allocator->poolCount;i-- > 0;)
+	{
+		descriptorSetAllocateInfo.descriptorPool = allocator->pools[i];
+		VkResult result = vkAllocateDescriptorSets(device,&descriptorSetAllocateInfo,outSet);
+		if(result == VK_SUCCESS)
+		{
+			if(outPool)
+			{
+				*outPool = descriptorSetAllocateInfo.descriptorPool;
+			}
+			return true;
+		}
+		if(result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+		{
+			SetError("Function call vkAllocateDescriptorSets(device,&descriptorSetAllocateInfo,outSet) returned %s.",VkResultToString(result));
+			return false;
+		}
+	}
+	if(!CreateDescriptorPool(device,allocator,variableDescriptorCount))
+	{
+		return false;
+	}
+	descriptorSetAllocateInfo.descriptorPool = allocator->pools[allocator->poolCount - 1];
+	VkResult result = vkAllocateDescriptorSets(device,&descriptorSetAllocateInfo,outSet);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkAllocateDescriptorSets(device,&descriptorSetAllocateInfo,outSet) returned %s even from a newly created descriptor pool.",VkResultToString(result));
+		return false;
+	}
+	if(outPool)
+	{
+		*outPool = descriptorSetAllocateInfo.descriptorPool;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef VULKAN_DESCRIPTOR_H
+#define VULKAN_DESCRIPTOR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "vulkan.h"
+
+#define DESCRIPTOR_ALLOCATOR_MAX_POOL_SIZES 4
+
+typedef struct DescriptorAllocator
+{
+	VkDescriptorPool* pools;
+	size_t poolCount;
+	VkDescriptorPoolCreateFlags poolFlags;
+	VkDescriptorPoolSize poolSizes[DESCRIPTOR_ALLOCATOR_MAX_POOL_SIZES];
+	uint32_t poolSizeCount;
+	uint32_t setsPerPool;
+} DescriptorAllocator;
+
+//Pool sizes are given per set; every new pool is twice as big as the previous one.
+bool CreateDescriptorAllocator(VkDevice device,VkDescriptorPoolCreateFlags poolFlags,const VkDescriptorPoolSize* poolSizes,uint32_t poolSizeCount,uint32_t initialSetsPerPool,DescriptorAllocator* outAllocator);
+void DestroyDescriptorAllocator(VkDevice device,DescriptorAllocator* allocator);
+bool AllocateDescriptorSet(VkDevice device,DescriptorAllocator* allocator,VkDescriptorSetLayout layout,uint32_t variableDescriptorCount,VkDescriptorSet* outSet,VkDescriptorPool* outPool);
+
+#endif
\ No newline at end of file
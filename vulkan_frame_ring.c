@@ -0,0 +1,83 @@
+#include "vulkan_frame_ring.h"
+
+static bool CreateFrameRingBuffer(FrameRing* ring,VkDeviceSize partitionSize)
+{
+	VkDeviceSize size = partitionSize * ring->partitionCount;
+	//Device-local host-visible memory lets the GPU read the data without going over the bus, but not every device has it.
+	if(CreateRenderingBuffer(ring->device,ring->allocator,size,NULL,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,ring->bufferUsage,MEMORY_STRATEGY_FREE_LIST,&ring->buffer))
+	{
+		ring->partitionSize = partitionSize;
+		return true;
+	}
+	if(!CreateRenderingBuffer(ring->device,ring->allocator,size,NULL,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,ring->bufferUsage,MEMORY_STRATEGY_FREE_LIST,&ring->buffer))
+	{
+		return false;
+	}
+	ring->partitionSize = partitionSize;
+	return true;
+}
+
+bool CreateFrameRing(VkDevice device,MemoryAllocator* allocator,VkDeviceSize partitionSize,uint32_t partitionCount,VkBufferUsageFlags bufferUsage,FrameRing* outRing)
+{
+	*outRing = (FrameRing){
+		.device = device,
+		.allocator = allocator,
+		.bufferUsage = bufferUsage,
+		.partitionCount = partitionCount
+	};
+	return CreateFrameRingBuffer(outRing,partitionSize);
+}
+
+void DestroyFrameRing(FrameRing* ring)
+{
+	if(ring->buffer.buffer)
+	{
+		DestroyRenderingBuffer(ring->device,ring->buffer);
+	}
+	*ring = (FrameRing){0};
+}
+
+void BeginFrameRingPartition(FrameRing* ring,uint32_t partition)
+{
+	ring->currentPartition = partition;
+	ring->head = 0;
+}
+
+bool AllocateFrameData(FrameRing* ring,VkDeviceSize size,VkDeviceSize alignment,FrameAllocation* outAllocation)
+{
+	VkDeviceSize partitionBegin = ring->partitionSize * ring->currentPartition;
+	//Partitions start at a multiple of the partition size, which is kept a power of two, so aligning within one is enough.
+	VkDeviceSize offset = (ring->head + alignment - 1) & ~(alignment - 1);
+	if(offset > ring->partitionSize || size > ring->partitionSize - offset)
+	{
+		SetError("Couldn't allocate %llu bytes from a %llu byte frame ring partition.",(unsigned long long)size,(unsigned long long)ring->partitionSize);
+		return false;
+	}
+	ring->head = offset + size;
+	*outAllocation = (FrameAllocation){
+		.data = (uint8_t*)ring->buffer.allocation.mappedData + partitionBegin + offset,
+		.buffer = ring->buffer.buffer,
+		.offset = partitionBegin + offset
+	};
+	return true;
+}
+
+bool GrowFrameRing(FrameRing* ring,VkDeviceSize minPartitionSize)
+{
+	VkDeviceSize partitionSize = ring->partitionSize;
+	while(partitionSize < minPartitionSize)
+	{
+		partitionSize *= 2;
+	}
+	RenderingBuffer oldBuffer = ring->buffer;
+	VkDeviceSize oldPartitionSize = ring->partitionSize;
+	if(!CreateFrameRingBuffer(ring,partitionSize))
+	{
+		ring->buffer = oldBuffer;
+		ring->partitionSize = oldPartitionSize;
+		return false;
+	}
+	DestroyRenderingBuffer(ring->device,oldBuffer);
+	ring->head = 0;
+	return true;
+}
\ No newline at end of file
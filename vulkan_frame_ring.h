@@ -0,0 +1,40 @@
+#ifndef VULKAN_FRAME_RING_H
+#define VULKAN_FRAME_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vulkan.h"
+#include "vulkan_buffer.h"
+#include "vulkan_memory.h"
+
+//One persistently mapped buffer split into a partition per frame in flight; every frame bump-allocates from its own partition.
+//The partition size has to be a power of two.
+typedef struct FrameRing
+{
+	VkDevice device;
+	MemoryAllocator* allocator;
+	RenderingBuffer buffer;
+	VkBufferUsageFlags bufferUsage;
+	VkDeviceSize partitionSize;
+	uint32_t partitionCount;
+	uint32_t currentPartition;
+	VkDeviceSize head;
+} FrameRing;
+
+typedef struct FrameAllocation
+{
+	void* data;
+	VkBuffer buffer;
+	VkDeviceSize offset;
+} FrameAllocation;
+
+bool CreateFrameRing(VkDevice device,MemoryAllocator* allocator,VkDeviceSize partitionSize,uint32_t partitionCount,VkBufferUsageFlags bufferUsage,FrameRing* outRing);
+void DestroyFrameRing(FrameRing* ring);
+//Must only be called once the GPU stopped reading the partition, i.e. after waiting for that frame's fence.
+void BeginFrameRingPartition(FrameRing* ring,uint32_t partition);
+//Alignment has to be a power of two; returned memory is host-coherent and stays valid until the partition is begun again.
+bool AllocateFrameData(FrameRing* ring,VkDeviceSize size,VkDeviceSize alignment,FrameAllocation* outAllocation);
+//Replaces the buffer with a bigger one; the GPU must be idle and all earlier allocations are lost.
+bool GrowFrameRing(FrameRing* ring,VkDeviceSize minPartitionSize);
+
+#endif
\ No newline at end of file
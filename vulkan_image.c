@@ -1,16 +1,19 @@
 #include "vulkan_image.h"
 
-#include "vulkan_buffer.h"
-
-bool CreateRenderingImage(VkDevice device,VkPhysicalDevice physicalDevice,VkExtent2D imageExtent,VkImageUsageFlags imageUsage,RenderingImage* outImage)
+bool CreateRenderingImage(VkDevice device,MemoryAllocator* allocator,VkExtent2D imageExtent,VkImageUsageFlags imageUsage,uint32_t queueFamilyIndexCount,const uint32_t* queueFamilyIndices,RenderingImage* outImage)
 {
+	outImage->image = VK_NULL_HANDLE;
+	outImage->imageView = VK_NULL_HANDLE;
+	outImage->allocation = (MemoryAllocation){0};
 	outImage->size = (VkDeviceSize)imageExtent.width * imageExtent.height * 4;
 	outImage->imageExtent = imageExtent;
 	outImage->imageUsage = imageUsage;
 	
 	VkImageCreateInfo imageCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.sharingMode = (queueFamilyIndexCount > 1) ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = (queueFamilyIndexCount > 1) ? queueFamilyIndexCount : 0,
+		.pQueueFamilyIndices = (queueFamilyIndexCount > 1) ? queueFamilyIndices : NULL,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
 		.arrayLayers = 1,
 		.mipLevels = 1,
@@ -31,30 +34,16 @@ bool CreateRenderingImage(VkDevice device,VkPhysicalDevice physicalDevice,VkExte
 
 	VkMemoryRequirements memoryRequirements = {0};
 	vkGetImageMemoryRequirements(device,outImage->image,&memoryRequirements);
-	uint32_t memoryTypeIndex = 0;
-	if(!FindMemoryTypeIndex(physicalDevice,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,memoryRequirements.memoryTypeBits,&memoryTypeIndex))
-	{
-		DestroyRenderingImage(device,*outImage);
-		return false;
-	}
-
-	VkMemoryAllocateInfo memoryAllocateInfo = {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.allocationSize = memoryRequirements.size,
-		.memoryTypeIndex = memoryTypeIndex
-	};
-	result = vkAllocateMemory(device,&memoryAllocateInfo,NULL,&outImage->memory);
-	if(result != VK_SUCCESS)
+	if(!AllocateMemory(allocator,&memoryRequirements,VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,MEMORY_RESOURCE_OPTIMAL,MEMORY_STRATEGY_FREE_LIST,&outImage->allocation))
 	{
 		DestroyRenderingImage(device,*outImage);
-		SetError("Function call vkAllocateMemory(device,&memoryAllocateInfo,NULL,&outImage->memory) returned %s.",VkResultToString(result));
 		return false;
 	}
-	result = vkBindImageMemory(device,outImage->image,outImage->memory,0);
+	result = vkBindImageMemory(device,outImage->image,outImage->allocation.memory,outImage->allocation.offset);
 	if(result != VK_SUCCESS)
 	{
 		DestroyRenderingImage(device,*outImage);
-		SetError("Function call vkBindImageMemory(device,outImage->image,outImage->memory,0) returned %s.",VkResultToString(result));
+		SetError("Function call vkBindImageMemory(device,outImage->image,outImage->allocation.memory,outImage->allocation.offset) returned %s.",VkResultToString(result));
 		return false;
 	}
 
@@ -89,115 +78,5 @@ void DestroyRenderingImage(VkDevice device,RenderingImage image)
 {
 	vkDestroyImageView(device,image.imageView,NULL);
 	vkDestroyImage(device,image.image,NULL);
-	vkFreeMemory(device,image.memory,NULL);
-}
-
-bool FillImageTexels(VkDevice device,VkPhysicalDevice physicalDevice,VkCommandPool transferCommandPool,VkQueue transferQueue,const uint8_t* texels,RenderingImage image)
-{
-	RenderingBuffer stagingBuffer = {0};
-	if(!CreateRenderingBuffer(device,physicalDevice,image.size,texels,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,VK_BUFFER_USAGE_TRANSFER_SRC_BIT,&stagingBuffer))
-	{
-		return false;
-	}
-
-	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandPool = transferCommandPool,
-		.commandBufferCount = 1
-	};
-	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
-	VkResult result = vkAllocateCommandBuffers(device,&commandBufferAllocateInfo,&commandBuffer);
-	if(result != VK_SUCCESS)
-	{
-		DestroyRenderingBuffer(device,stagingBuffer);
-		SetError("Function call vkAllocateCommandBuffers(device,&commandBufferAllocateInfo,&commandBuffer) returned %s.",VkResultToString(result));
-		return false;
-	}
-
-	VkCommandBufferBeginInfo commandBufferBeginInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
-	};
-	result = vkBeginCommandBuffer(commandBuffer,&commandBufferBeginInfo);
-	if(result != VK_SUCCESS)
-	{
-		vkFreeCommandBuffers(device,transferCommandPool,1,&commandBuffer);
-		DestroyRenderingBuffer(device,stagingBuffer);
-		SetError("Function call vkBeginCommandBuffer(commandBuffer,&commandBufferBeginInfo) returned %s.",VkResultToString(result));
-		return false;
-	}
-
-	VkImageMemoryBarrier barrier = {
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-		.image = image.image,
-		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		.srcAccessMask = 0,
-		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-		.subresourceRange = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.layerCount = 1,
-			.levelCount = 1
-		}
-	};
-	vkCmdPipelineBarrier(commandBuffer,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,0,NULL,0,NULL,1,&barrier);
-
-	VkBufferImageCopy bufferImageCopy = {
-		.bufferOffset = 0,
-		.bufferRowLength = 0,
-		.bufferImageHeight = 0,
-		.imageOffset = {0,0,0},
-		.imageExtent = {image.imageExtent.width,image.imageExtent.height,1},
-		.imageSubresource = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.layerCount = 1
-		}
-	};
-
-	vkCmdCopyBufferToImage(commandBuffer,stagingBuffer.buffer,image.image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,&bufferImageCopy);
-
-	barrier.srcAccessMask = barrier.dstAccessMask;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	barrier.oldLayout = barrier.newLayout;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-	vkCmdPipelineBarrier(commandBuffer,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,0,0,NULL,0,NULL,1,&barrier);
-
-	result = vkEndCommandBuffer(commandBuffer);
-	if(result != VK_SUCCESS)
-	{
-		vkFreeCommandBuffers(device,transferCommandPool,1,&commandBuffer);
-		DestroyRenderingBuffer(device,stagingBuffer);
-		SetError("Function call vkEndCommandBuffer(commandBuffer) returned %s.",VkResultToString(result));
-		return false;
-	}
-
-	VkSubmitInfo submitInfo = {
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffer
-	};
-	result = vkQueueSubmit(transferQueue,1,&submitInfo,VK_NULL_HANDLE);
-	if(result != VK_SUCCESS)
-	{
-		vkFreeCommandBuffers(device,transferCommandPool,1,&commandBuffer);
-		DestroyRenderingBuffer(device,stagingBuffer);
-		SetError("Function call vkQueueSubmit(transferQueue,1,&submitInfo,VK_NULL_HANDLE) returned %s.",VkResultToString(result));
-		return false;
-	}
-	result = vkQueueWaitIdle(transferQueue);
-	if(result != VK_SUCCESS)
-	{
-		vkFreeCommandBuffers(device,transferCommandPool,1,&commandBuffer);
-		DestroyRenderingBuffer(device,stagingBuffer);
-		SetError("Function call vkQueueWaitIdle(transferQueue) returned %s.",VkResultToString(result));
-		return false;
-	}
-
-	vkFreeCommandBuffers(device,transferCommandPool,1,&commandBuffer);
-	DestroyRenderingBuffer(device,stagingBuffer);
-	return true;
+	FreeMemory(&image.allocation);
 }
\ No newline at end of file
@@ -3,19 +3,20 @@
 
 #include <stdbool.h>
 #include "vulkan.h"
+#include "vulkan_memory.h"
 
 typedef struct RenderingImage
 {
 	VkImage image;
-	VkDeviceMemory memory;
+	MemoryAllocation allocation;
 	VkImageView imageView;
 	VkDeviceSize size;
 	VkExtent2D imageExtent;
 	VkImageUsageFlags imageUsage;
 } RenderingImage;
 
-bool CreateRenderingImage(VkDevice device,VkPhysicalDevice physicalDevice,VkExtent2D imageExtent,VkImageUsageFlags imageUsage,RenderingImage* outImage);
+//More than one queue family makes the image shared concurrently between them, so no ownership transfers are needed.
+bool CreateRenderingImage(VkDevice device,MemoryAllocator* allocator,VkExtent2D imageExtent,VkImageUsageFlags imageUsage,uint32_t queueFamilyIndexCount,const uint32_t* queueFamilyIndices,RenderingImage* outImage);
 void DestroyRenderingImage(VkDevice device,RenderingImage image);
-bool FillImageTexels(VkDevice device,VkPhysicalDevice physicalDevice,VkCommandPool transferCommandPool,VkQueue transferQueue,const uint8_t* texels,RenderingImage image);
 
 #endif
\ No newline at end of file
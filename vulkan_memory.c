@@ -0,0 +1,367 @@
+#include "vulkan_memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static VkDeviceSize AlignUp(VkDeviceSize value,VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+//Linear and optimal resources closer than bufferImageGranularity to each other may alias on some hardware.
+static bool IsOnSamePage(VkDeviceSize resourceEnd,VkDeviceSize nextResourceOffset,VkDeviceSize granularity)
+{
+	return ((resourceEnd - 1) & ~(granularity - 1)) == (nextResourceOffset & ~(granularity - 1));
+}
+
+static bool InsertRange(MemoryBlock* block,size_t index,MemoryRange range)
+{
+	if(block->rangeCount == block->rangeCapacity)
+	{
+		size_t newCapacity = block->rangeCapacity ? block->rangeCapacity * 2 : 16;
+		MemoryRange* tmp = realloc(block->ranges,newCapacity * sizeof(*tmp));
+		if(!tmp)
+		{
+			SetError("Couldn't allocate %zu bytes of memory.",newCapacity * sizeof(*tmp));
+			return false;
+		}
+		block->ranges = tmp;
+		block->rangeCapacity = newCapacity;
+	}
+	memmove(&block->ranges[index + 1],&block->ranges[index],(block->rangeCount - index) * sizeof(*block->ranges));
+	block->ranges[index] = range;
+	++block->rangeCount;
+	return true;
+}
+
+static void RemoveRange(MemoryBlock* block,size_t index)
+{
+	memmove(&block->ranges[index],&block->ranges[index + 1],(block->rangeCount - index - 1) * sizeof(*block->ranges));
+	--block->rangeCount;
+}
+
+static bool AllocateFromFreeList(MemoryBlock* block,VkDeviceSize size,VkDeviceSize alignment,uint32_t resourceType,VkDeviceSize* outOffset)
+{
+	VkDeviceSize granularity = block->allocator->bufferImageGranularity;
+	for(size_t i = 0;i < block->rangeCount;++i)
+	{
+		MemoryRange range = block->ranges[i];
+		if(range.resourceType != 0 || range.size < size)
+		{
+			continue;
+		}
+		//Free ranges are always merged, so both neighbours (if any) are in use.
+		VkDeviceSize offset = AlignUp(range.offset,alignment);
+		if(i > 0)
+		{
+			MemoryRange previous = block->ranges[i - 1];
+			if(previous.resourceType != resourceType && IsOnSamePage(previous.offset + previous.size,offset,granularity))
+			{
+				offset = AlignUp(offset,granularity);
+			}
+		}
+		VkDeviceSize end = offset + size;
+		if(end > range.offset + range.size)
+		{
+			continue;
+		}
+		if(i + 1 < block->rangeCount)
+		{
+			MemoryRange next = block->ranges[i + 1];
+			if(next.resourceType != resourceType && IsOnSamePage(end,next.offset,granularity))
+			{
+				continue;
+			}
+		}
+
+		//Split into [padding][allocation][remainder]; empty parts are left out.
+		size_t index = i;
+		if(offset > range.offset)
+		{
+			block->ranges[index].size = offset - range.offset;
+			if(!InsertRange(block,++index,(MemoryRange){offset,size,resourceType}))
+			{
+				block->ranges[i] = range;
+				return false;
+			}
+		}
+		else
+		{
+			block->ranges[index] = (MemoryRange){offset,size,resourceType};
+		}
+		if(end < range.offset + range.size && !InsertRange(block,index + 1,(MemoryRange){end,range.offset + range.size - end,0}))
+		{
+			//Out of host memory; the remainder is simply leaked into the allocation.
+			block->ranges[index].size = range.offset + range.size - offset;
+		}
+		*outOffset = offset;
+		return true;
+	}
+	return false;
+}
+
+static void FreeFromFreeList(MemoryBlock* block,VkDeviceSize offset)
+{
+	size_t low = 0;
+	size_t high = block->rangeCount;
+	while(low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if(block->ranges[middle].offset < offset)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	if(low == block->rangeCount || block->ranges[low].offset != offset)
+	{
+		return;
+	}
+
+	size_t index = low;
+	block->ranges[index].resourceType = 0;
+	if(index + 1 < block->rangeCount && block->ranges[index + 1].resourceType == 0)
+	{
+		block->ranges[index].size += block->ranges[index + 1].size;
+		RemoveRange(block,index + 1);
+	}
+	if(index > 0 && block->ranges[index - 1].resourceType == 0)
+	{
+		block->ranges[index - 1].size += block->ranges[index].size;
+		RemoveRange(block,index);
+	}
+}
+
+static bool AllocateFromLinear(MemoryBlock* block,VkDeviceSize size,VkDeviceSize alignment,uint32_t resourceType,VkDeviceSize* outOffset)
+{
+	VkDeviceSize offset = AlignUp(block->linearTop,alignment);
+	if(block->allocationCount > 0 && block->linearLastResourceType != resourceType && IsOnSamePage(block->linearTop,offset,block->allocator->bufferImageGranularity))
+	{
+		offset = AlignUp(offset,block->allocator->bufferImageGranularity);
+	}
+	if(offset + size > block->size)
+	{
+		return false;
+	}
+	block->linearTop = offset + size;
+	block->linearLastResourceType = resourceType;
+	*outOffset = offset;
+	return true;
+}
+
+static bool AllocateFromBlock(MemoryBlock* block,VkDeviceSize size,VkDeviceSize alignment,uint32_t resourceType,VkDeviceSize* outOffset)
+{
+	bool allocated = (block->strategy == MEMORY_STRATEGY_LINEAR) ? AllocateFromLinear(block,size,alignment,resourceType,outOffset) : AllocateFromFreeList(block,size,alignment,resourceType,outOffset);
+	if(allocated)
+	{
+		++block->allocationCount;
+		block->usedSize += size;
+	}
+	return allocated;
+}
+
+static void DestroyMemoryBlock(MemoryBlock* block)
+{
+	vkFreeMemory(block->allocator->device,block->memory,NULL);
+	free(block->ranges);
+	free(block);
+}
+
+static MemoryBlock* CreateMemoryBlock(MemoryAllocator* allocator,uint32_t memoryTypeIndex,MemoryStrategy strategy,VkDeviceSize size,bool dedicated)
+{
+	MemoryBlock** tmp = realloc(allocator->blocks,(allocator->blockCount + 1) * sizeof(*tmp));
+	if(!tmp)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",(allocator->blockCount + 1) * sizeof(*tmp));
+		return NULL;
+	}
+	allocator->blocks = tmp;
+
+	MemoryBlock* block = calloc(1,sizeof(*block));
+	if(!block)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",sizeof(*block));
+		return NULL;
+	}
+	*block = (MemoryBlock){
+		.allocator = allocator,
+		.size = size,
+		.memoryTypeIndex = memoryTypeIndex,
+		.strategy = strategy,
+		.dedicated = dedicated
+	};
+	if(strategy == MEMORY_STRATEGY_FREE_LIST && !InsertRange(block,0,(MemoryRange){0,size,0}))
+	{
+		free(block);
+		return NULL;
+	}
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = size,
+		.memoryTypeIndex = memoryTypeIndex
+	};
+	VkResult result = vkAllocateMemory(allocator->device,&memoryAllocateInfo,NULL,&block->memory);
+	if(result != VK_SUCCESS)
+	{
+		free(block->ranges);
+		free(block);
+		SetError("Function call vkAllocateMemory(allocator->device,&memoryAllocateInfo,NULL,&block->memory) returned %s.",VkResultToString(result));
+		return NULL;
+	}
+	if(allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* mappedData = NULL;
+		result = vkMapMemory(allocator->device,block->memory,0,VK_WHOLE_SIZE,0,&mappedData);
+		if(result != VK_SUCCESS)
+		{
+			DestroyMemoryBlock(block);
+			SetError("Function call vkMapMemory(allocator->device,block->memory,0,VK_WHOLE_SIZE,0,&mappedData) returned %s.",VkResultToString(result));
+			return NULL;
+		}
+		block->mappedData = mappedData;
+	}
+	allocator->blocks[allocator->blockCount++] = block;
+	return block;
+}
+
+//Small heaps (e.g. the 256MiB device-local host-visible one) would be exhausted by just a few default-sized blocks.
+static VkDeviceSize GetBlockSize(const MemoryAllocator* allocator,uint32_t memoryTypeIndex)
+{
+	uint32_t heapIndex = allocator->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	VkDeviceSize heapSize = allocator->memoryProperties.memoryHeaps[heapIndex].size;
+	return (heapSize / 8 < MEMORY_BLOCK_SIZE) ? heapSize / 8 : MEMORY_BLOCK_SIZE;
+}
+
+bool CreateMemoryAllocator(VkDevice device,VkPhysicalDevice physicalDevice,MemoryAllocator* outAllocator)
+{
+	VkPhysicalDeviceProperties properties = {0};
+	vkGetPhysicalDeviceProperties(physicalDevice,&properties);
+	*outAllocator = (MemoryAllocator){
+		.device = device,
+		.bufferImageGranularity = properties.limits.bufferImageGranularity ? properties.limits.bufferImageGranularity : 1
+	};
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice,&outAllocator->memoryProperties);
+	return true;
+}
+
+void DestroyMemoryAllocator(MemoryAllocator* allocator)
+{
+	for(size_t i = 0;i < allocator->blockCount;++i)
+	{
+		DestroyMemoryBlock(allocator->blocks[i]);
+	}
+	free(allocator->blocks);
+	*allocator = (MemoryAllocator){0};
+}
+
+bool AllocateMemory(MemoryAllocator* allocator,const VkMemoryRequirements* requirements,VkMemoryPropertyFlags memoryProperties,MemoryResourceType resourceType,MemoryStrategy strategy,MemoryAllocation* outAllocation)
+{
+	uint32_t memoryTypeIndex = UINT32_MAX;
+	for(uint32_t i = 0;i < allocator->memoryProperties.memoryTypeCount;++i)
+	{
+		if((requirements->memoryTypeBits & (1u << i)) && (allocator->memoryProperties.memoryTypes[i].propertyFlags & memoryProperties) == memoryProperties)
+		{
+			memoryTypeIndex = i;
+			break;
+		}
+	}
+	if(memoryTypeIndex == UINT32_MAX)
+	{
+		SetError("Couldn't get appropriate memory type index.");
+		return false;
+	}
+
+	VkDeviceSize offset = 0;
+	MemoryBlock* block = NULL;
+	//Resources bigger than half a block get their own, otherwise they'd leave most of a shared block unusable.
+	VkDeviceSize blockSize = GetBlockSize(allocator,memoryTypeIndex);
+	bool dedicated = requirements->size > blockSize / 2;
+	if(!dedicated)
+	{
+		for(size_t i = 0;i < allocator->blockCount;++i)
+		{
+			MemoryBlock* candidate = allocator->blocks[i];
+			if(candidate->memoryTypeIndex == memoryTypeIndex && candidate->strategy == strategy && !candidate->dedicated &&
+			   AllocateFromBlock(candidate,requirements->size,requirements->alignment,resourceType,&offset))
+			{
+				block = candidate;
+				break;
+			}
+		}
+	}
+	if(!block)
+	{
+		block = CreateMemoryBlock(allocator,memoryTypeIndex,strategy,dedicated ? requirements->size : blockSize,dedicated);
+		if(!block)
+		{
+			return false;
+		}
+		if(!AllocateFromBlock(block,requirements->size,requirements->alignment,resourceType,&offset))
+		{
+			//The new block was appended last and nothing else lives in it.
+			--allocator->blockCount;
+			DestroyMemoryBlock(block);
+			SetError("Couldn't allocate %llu bytes from a new memory block.",(unsigned long long)requirements->size);
+			return false;
+		}
+	}
+
+	*outAllocation = (MemoryAllocation){
+		.memory = block->memory,
+		.offset = offset,
+		.size = requirements->size,
+		.mappedData = block->mappedData ? block->mappedData + offset : NULL,
+		.block = block
+	};
+	return true;
+}
+
+void FreeMemory(MemoryAllocation* allocation)
+{
+	MemoryBlock* block = allocation->block;
+	if(!block)
+	{
+		return;
+	}
+	if(block->strategy == MEMORY_STRATEGY_FREE_LIST)
+	{
+		FreeFromFreeList(block,allocation->offset);
+	}
+	--block->allocationCount;
+	block->usedSize -= allocation->size;
+	if(block->allocationCount == 0)
+	{
+		block->linearTop = 0;
+	}
+	*allocation = (MemoryAllocation){0};
+
+	//Shared blocks are kept around for reuse, dedicated ones are returned to the driver right away.
+	if(block->dedicated && block->allocationCount == 0)
+	{
+		MemoryAllocator* allocator = block->allocator;
+		for(size_t i = 0;i < allocator->blockCount;++i)
+		{
+			if(allocator->blocks[i] == block)
+			{
+				allocator->blocks[i] = allocator->blocks[--allocator->blockCount];
+				break;
+			}
+		}
+		DestroyMemoryBlock(block);
+	}
+}
+
+void GetMemoryStatistics(const MemoryAllocator* allocator,MemoryStatistics* outStatistics)
+{
+	*outStatistics = (MemoryStatistics){.blockCount = allocator->blockCount};
+	for(size_t i = 0;i < allocator->blockCount;++i)
+	{
+		outStatistics->allocationCount += allocator->blocks[i]->allocationCount;
+		outStatistics->reservedBytes += allocator->blocks[i]->size;
+		outStatistics->usedBytes += allocator->blocks[i]->usedSize;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef VULKAN_MEMORY_H
+#define VULKAN_MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "vulkan.h"
+
+#define MEMORY_BLOCK_SIZE ((VkDeviceSize)64 * 1024 * 1024)
+
+typedef enum MemoryStrategy
+{
+	//General purpose: first fit over a sorted list of ranges, neighbouring free ranges are merged on free.
+	MEMORY_STRATEGY_FREE_LIST,
+	//Bump allocation for short-lived memory; a block is rewound once everything in it was freed.
+	MEMORY_STRATEGY_LINEAR
+} MemoryStrategy;
+
+typedef enum MemoryResourceType
+{
+	MEMORY_RESOURCE_LINEAR = 1, //Buffers and linearly tiled images.
+	MEMORY_RESOURCE_OPTIMAL = 2 //Optimally tiled images.
+} MemoryResourceType;
+
+typedef struct MemoryRange
+{
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint32_t resourceType; //0 for free ranges.
+} MemoryRange;
+
+typedef struct MemoryBlock
+{
+	struct MemoryAllocator* allocator;
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	uint32_t memoryTypeIndex;
+	MemoryStrategy strategy;
+	bool dedicated;
+	uint8_t* mappedData;
+	size_t allocationCount;
+	VkDeviceSize usedSize;
+	MemoryRange* ranges;
+	size_t rangeCount;
+	size_t rangeCapacity;
+	VkDeviceSize linearTop;
+	uint32_t linearLastResourceType;
+} MemoryBlock;
+
+typedef struct MemoryAllocator
+{
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkDeviceSize bufferImageGranularity;
+	MemoryBlock** blocks;
+	size_t blockCount;
+} MemoryAllocator;
+
+typedef struct MemoryAllocation
+{
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void* mappedData; //Host-visible blocks are persistently mapped, NULL otherwise.
+	MemoryBlock* block;
+} MemoryAllocation;
+
+typedef struct MemoryStatistics
+{
+	size_t blockCount;
+	size_t allocationCount;
+	VkDeviceSize reservedBytes;
+	VkDeviceSize usedBytes;
+} MemoryStatistics;
+
+//Sub-allocates resources out of big VkDeviceMemory blocks, one set of blocks per memory type and strategy. Not thread-safe.
+bool CreateMemoryAllocator(VkDevice device,VkPhysicalDevice physicalDevice,MemoryAllocator* outAllocator);
+void DestroyMemoryAllocator(MemoryAllocator* allocator);
+bool AllocateMemory(MemoryAllocator* allocator,const VkMemoryRequirements* requirements,VkMemoryPropertyFlags memoryProperties,MemoryResourceType resourceType,MemoryStrategy strategy,MemoryAllocation* outAllocation);
+void FreeMemory(MemoryAllocation* allocation);
+void GetMemoryStatistics(const MemoryAllocator* allocator,MemoryStatistics* outStatistics);
+
+#endif
\ No newline at end of file
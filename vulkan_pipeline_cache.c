@@ -0,0 +1,130 @@
+#include "vulkan_pipeline_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+static void* ReadWholeFile(const char* filePath,size_t* outSize)
+{
+	FILE* file = fopen(filePath,"rb");
+	if(!file)
+	{
+		return NULL;
+	}
+	void* data = NULL;
+	long size = 0;
+	if(fseek(file,0,SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file,0,SEEK_SET) == 0)
+	{
+		data = malloc((size_t)size);
+		if(data && fread(data,1,(size_t)size,file) != (size_t)size)
+		{
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(file);
+	*outSize = (size_t)size;
+	return data;
+}
+
+static bool IsPipelineCacheCompatible(VkPhysicalDevice physicalDevice,const void* data,size_t size)
+{
+	VkPipelineCacheHeaderVersionOne header = {0};
+	if(size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header,data,sizeof(header));
+
+	VkPhysicalDeviceProperties properties = {0};
+	vkGetPhysicalDeviceProperties(physicalDevice,&properties);
+	return header.headerSize >= sizeof(header) && header.headerSize <= size &&
+		   header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		   header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+		   memcmp(header.pipelineCacheUUID,properties.pipelineCacheUUID,VK_UUID_SIZE) == 0;
+}
+
+bool CreatePipelineCacheFromFile(VkDevice device,VkPhysicalDevice physicalDevice,const char* filePath,VkPipelineCache* outPipelineCache)
+{
+	size_t dataSize = 0;
+	void* data = filePath ? ReadWholeFile(filePath,&dataSize) : NULL;
+	if(data && !IsPipelineCacheCompatible(physicalDevice,data,dataSize))
+	{
+		free(data);
+		data = NULL;
+	}
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data ? dataSize : 0,
+		.pInitialData = data
+	};
+	VkResult result = vkCreatePipelineCache(device,&pipelineCacheCreateInfo,NULL,outPipelineCache);
+	free(data);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkCreatePipelineCache(device,&pipelineCacheCreateInfo,NULL,outPipelineCache) returned %s.",VkResultToString(result));
+		return false;
+	}
+	return true;
+}
+
+bool SavePipelineCacheToFile(VkDevice device,VkPipelineCache pipelineCache,const char* filePath)
+{
+	size_t dataSize = 0;
+	VkResult result = vkGetPipelineCacheData(device,pipelineCache,&dataSize,NULL);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkGetPipelineCacheData(device,pipelineCache,&dataSize,NULL) returned %s.",VkResultToString(result));
+		return false;
+	}
+	void* data = malloc(dataSize);
+	if(!data)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",dataSize);
+		return false;
+	}
+	result = vkGetPipelineCacheData(device,pipelineCache,&dataSize,data);
+	if(result != VK_SUCCESS)
+	{
+		free(data);
+		SetError("Function call vkGetPipelineCacheData(device,pipelineCache,&dataSize,data) returned %s.",VkResultToString(result));
+		return false;
+	}
+
+	//Written under a temporary name first, so that a crash mid-write never leaves a truncated cache behind.
+	char temporaryPath[1024] = {0};
+	snprintf(temporaryPath,sizeof(temporaryPath),"%s.tmp",filePath);
+	FILE* file = fopen(temporaryPath,"wb");
+	if(!file)
+	{
+		free(data);
+		SetError("Couldn't open file \"%s\" for writing.",temporaryPath);
+		return false;
+	}
+	bool written = fwrite(data,1,dataSize,file) == dataSize;
+	written = (fclose(file) == 0) && written;
+	free(data);
+	if(!written)
+	{
+		remove(temporaryPath);
+		SetError("Couldn't write %zu bytes to file \"%s\".",dataSize,temporaryPath);
+		return false;
+	}
+	//Replacing in one step means a crash can't leave the cache missing either; POSIX rename already overwrites atomically.
+#if defined(_WIN32)
+	if(!MoveFileExA(temporaryPath,filePath,MOVEFILE_REPLACE_EXISTING))
+#else
+	if(rename(temporaryPath,filePath) != 0)
+#endif
+	{
+		remove(temporaryPath);
+		SetError("Couldn't rename file \"%s\" to \"%s\".",temporaryPath,filePath);
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
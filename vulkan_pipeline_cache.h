@@ -0,0 +1,11 @@
+#ifndef VULKAN_PIPELINE_CACHE_H
+#define VULKAN_PIPELINE_CACHE_H
+
+#include <stdbool.h>
+#include "vulkan.h"
+
+//Cache data whose header doesn't match the physical device (vendor, device or UUID) is discarded and an empty cache is created instead.
+bool CreatePipelineCacheFromFile(VkDevice device,VkPhysicalDevice physicalDevice,const char* filePath,VkPipelineCache* outPipelineCache);
+bool SavePipelineCacheToFile(VkDevice device,VkPipelineCache pipelineCache,const char* filePath);
+
+#endif
\ No newline at end of file
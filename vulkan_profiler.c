@@ -0,0 +1,238 @@
+#include "vulkan_profiler.h"
+
+#include <stdlib.h>
+
+#define PIPELINE_STATISTIC_FLAGS (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |\
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+//Statistics are written in the order of their flag bits.
+#define PIPELINE_STATISTIC_COUNT 5
+
+bool CreateGpuProfiler(VkDevice device,VkPhysicalDevice physicalDevice,uint32_t queueFamilyIndex,uint32_t frameCount,bool pipelineStatistics,bool hostQueryReset,GpuProfiler* outProfiler)
+{
+	if(frameCount > GPU_PROFILER_MAX_FRAMES)
+	{
+		SetError("GPU profiler supports at most %d frames.",GPU_PROFILER_MAX_FRAMES);
+		return false;
+	}
+	*outProfiler = (GpuProfiler){
+		.device = device,
+		.hostQueryReset = hostQueryReset,
+		.frameCount = frameCount
+	};
+
+	uint32_t queueFamilyPropertyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice,&queueFamilyPropertyCount,NULL);
+	VkQueueFamilyProperties* queueFamilyProperties = malloc(queueFamilyPropertyCount * sizeof(*queueFamilyProperties));
+	if(!queueFamilyProperties)
+	{
+		SetError("Couldn't allocate %zu bytes of memory.",queueFamilyPropertyCount * sizeof(*queueFamilyProperties));
+		return false;
+	}
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice,&queueFamilyPropertyCount,queueFamilyProperties);
+	uint32_t timestampValidBits = 0;
+	if(queueFamilyIndex < queueFamilyPropertyCount)
+	{
+		timestampValidBits = queueFamilyProperties[queueFamilyIndex].timestampValidBits;
+		//Transfer-only queues can write timestamps but not reset queries.
+		if(!hostQueryReset && !(queueFamilyProperties[queueFamilyIndex].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			timestampValidBits = 0;
+		}
+	}
+	free(queueFamilyProperties);
+
+	VkPhysicalDeviceProperties properties = {0};
+	vkGetPhysicalDeviceProperties(physicalDevice,&properties);
+	outProfiler->nanosecondsPerTick = properties.limits.timestampPeriod;
+	outProfiler->timestampMask = (timestampValidBits >= 64) ? UINT64_MAX : ((UINT64_C(1) << timestampValidBits) - 1);
+	if(timestampValidBits > 0)
+	{
+		VkResult result = vkCreateQueryPool(device,&(VkQueryPoolCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = frameCount * GPU_PROFILER_MAX_SCOPES * 2
+		},NULL,&outProfiler->timestampQueryPool);
+		if(result != VK_SUCCESS)
+		{
+			DestroyGpuProfiler(outProfiler);
+			SetError("Function call vkCreateQueryPool(device,...,NULL,&outProfiler->timestampQueryPool) returned %s.",VkResultToString(result));
+			return false;
+		}
+	}
+	if(pipelineStatistics)
+	{
+		VkResult result = vkCreateQueryPool(device,&(VkQueryPoolCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+			.queryCount = frameCount,
+			.pipelineStatistics = PIPELINE_STATISTIC_FLAGS
+		},NULL,&outProfiler->statisticsQueryPool);
+		if(result != VK_SUCCESS)
+		{
+			DestroyGpuProfiler(outProfiler);
+			SetError("Function call vkCreateQueryPool(device,...,NULL,&outProfiler->statisticsQueryPool) returned %s.",VkResultToString(result));
+			return false;
+		}
+	}
+	return true;
+}
+
+void DestroyGpuProfiler(GpuProfiler* profiler)
+{
+	vkDestroyQueryPool(profiler->device,profiler->timestampQueryPool,NULL);
+	vkDestroyQueryPool(profiler->device,profiler->statisticsQueryPool,NULL);
+	*profiler = (GpuProfiler){0};
+}
+
+//Keeps the previous results when the GPU somehow isn't done yet, instead of waiting for it.
+bool ReadGpuProfilerFrame(GpuProfiler* profiler,uint32_t frame)
+{
+	GpuProfilerFrame* profilerFrame = &profiler->frames[frame];
+	if(!profilerFrame->recorded)
+	{
+		return false;
+	}
+	bool complete = true;
+	if(profiler->timestampQueryPool && profilerFrame->scopeCount > 0)
+	{
+		uint64_t timestamps[GPU_PROFILER_MAX_SCOPES * 2] = {0};
+		VkResult result = vkGetQueryPoolResults(profiler->device,profiler->timestampQueryPool,frame * GPU_PROFILER_MAX_SCOPES * 2,profilerFrame->scopeCount * 2,
+												sizeof(timestamps),timestamps,sizeof(uint64_t),VK_QUERY_RESULT_64_BIT);
+		if(result == VK_SUCCESS)
+		{
+			for(uint32_t i = 0;i < profilerFrame->scopeCount;++i)
+			{
+				uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & profiler->timestampMask;
+				profiler->results[i] = (GpuScopeResult){
+					.name = profilerFrame->scopeNames[i],
+					.depth = profilerFrame->scopeDepths[i],
+					.milliseconds = (double)ticks * profiler->nanosecondsPerTick / 1000000.0
+				};
+			}
+			profiler->resultCount = profilerFrame->scopeCount;
+		}
+		else
+		{
+			complete = false;
+		}
+	}
+	if(profilerFrame->statisticsRecorded)
+	{
+		uint64_t statistics[PIPELINE_STATISTIC_COUNT] = {0};
+		VkResult result = vkGetQueryPoolResults(profiler->device,profiler->statisticsQueryPool,frame,1,sizeof(statistics),statistics,sizeof(statistics),VK_QUERY_RESULT_64_BIT);
+		if(result == VK_SUCCESS)
+		{
+			profiler->statistics = (GpuPipelineStatistics){
+				.inputAssemblyVertices = statistics[0],
+				.inputAssemblyPrimitives = statistics[1],
+				.vertexShaderInvocations = statistics[2],
+				.clippingPrimitives = statistics[3],
+				.fragmentShaderInvocations = statistics[4]
+			};
+			profiler->hasStatistics = true;
+		}
+		else
+		{
+			complete = false;
+		}
+	}
+	//A slot is read only once, so results of a slot that isn't reused don't get counted twice.
+	profilerFrame->recorded = !complete;
+	return complete;
+}
+
+void BeginGpuProfilerFrame(GpuProfiler* profiler,VkCommandBuffer commandBuffer,uint32_t frame)
+{
+	ReadGpuProfilerFrame(profiler,frame);
+	profiler->currentFrame = frame;
+	profiler->openScopeCount = 0;
+	profiler->untrackedScopeCount = 0;
+	GpuProfilerFrame* profilerFrame = &profiler->frames[frame];
+	*profilerFrame = (GpuProfilerFrame){
+		.recorded = true
+	};
+	if(profiler->hostQueryReset)
+	{
+		if(profiler->timestampQueryPool)
+		{
+			vkResetQueryPool(profiler->device,profiler->timestampQueryPool,frame * GPU_PROFILER_MAX_SCOPES * 2,GPU_PROFILER_MAX_SCOPES * 2);
+		}
+		if(profiler->statisticsQueryPool)
+		{
+			vkResetQueryPool(profiler->device,profiler->statisticsQueryPool,frame,1);
+		}
+		return;
+	}
+	if(profiler->timestampQueryPool)
+	{
+		vkCmdResetQueryPool(commandBuffer,profiler->timestampQueryPool,frame * GPU_PROFILER_MAX_SCOPES * 2,GPU_PROFILER_MAX_SCOPES * 2);
+	}
+	if(profiler->statisticsQueryPool)
+	{
+		vkCmdResetQueryPool(commandBuffer,profiler->statisticsQueryPool,frame,1);
+	}
+}
+
+void BeginGpuScope(GpuProfiler* profiler,VkCommandBuffer commandBuffer,const char* name)
+{
+	BeginDebugLabel(commandBuffer,name);
+	//Scopes beyond the limits still get their label, they just aren't timed.
+	if(profiler->openScopeCount >= GPU_PROFILER_MAX_SCOPES)
+	{
+		++profiler->untrackedScopeCount;
+		return;
+	}
+	GpuProfilerFrame* profilerFrame = &profiler->frames[profiler->currentFrame];
+	if(profilerFrame->scopeCount >= GPU_PROFILER_MAX_SCOPES)
+	{
+		profiler->openScopes[profiler->openScopeCount++] = UINT32_MAX;
+		return;
+	}
+	uint32_t scope = profilerFrame->scopeCount++;
+	profilerFrame->scopeNames[scope] = name;
+	profilerFrame->scopeDepths[scope] = profiler->openScopeCount;
+	profiler->openScopes[profiler->openScopeCount++] = scope;
+	if(profiler->timestampQueryPool)
+	{
+		vkCmdWriteTimestamp(commandBuffer,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,profiler->timestampQueryPool,(profiler->currentFrame * GPU_PROFILER_MAX_SCOPES + scope) * 2);
+	}
+}
+
+void EndGpuScope(GpuProfiler* profiler,VkCommandBuffer commandBuffer)
+{
+	if(profiler->untrackedScopeCount > 0)
+	{
+		--profiler->untrackedScopeCount;
+	}
+	else
+	{
+		uint32_t scope = profiler->openScopes[--profiler->openScopeCount];
+		if(scope != UINT32_MAX && profiler->timestampQueryPool)
+		{
+			vkCmdWriteTimestamp(commandBuffer,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,profiler->timestampQueryPool,(profiler->currentFrame * GPU_PROFILER_MAX_SCOPES + scope) * 2 + 1);
+		}
+	}
+	EndDebugLabel(commandBuffer);
+}
+
+void BeginGpuPipelineStatistics(GpuProfiler* profiler,VkCommandBuffer commandBuffer)
+{
+	if(profiler->statisticsQueryPool)
+	{
+		vkCmdBeginQuery(commandBuffer,profiler->statisticsQueryPool,profiler->currentFrame,0);
+		profiler->frames[profiler->currentFrame].statisticsRecorded = true;
+	}
+}
+
+void EndGpuPipelineStatistics(GpuProfiler* profiler,VkCommandBuffer commandBuffer)
+{
+	if(profiler->statisticsQueryPool)
+	{
+		vkCmdEndQuery(commandBuffer,profiler->statisticsQueryPool,profiler->currentFrame);
+	}
+}
+
+VkQueryPipelineStatisticFlags GetGpuPipelineStatisticFlags(const GpuProfiler* profiler)
+{
+	return profiler->statisticsQueryPool ? PIPELINE_STATISTIC_FLAGS : 0;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef VULKAN_PROFILER_H
+#define VULKAN_PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vulkan.h"
+
+//Enough for the frames in flight and for the upload batches.
+#define GPU_PROFILER_MAX_FRAMES 4
+#define GPU_PROFILER_MAX_SCOPES 16
+
+typedef struct GpuScopeResult
+{
+	const char* name;
+	uint32_t depth;
+	double milliseconds;
+} GpuScopeResult;
+
+typedef struct GpuPipelineStatistics
+{
+	uint64_t inputAssemblyVertices;
+	uint64_t inputAssemblyPrimitives;
+	uint64_t vertexShaderInvocations;
+	uint64_t clippingPrimitives;
+	uint64_t fragmentShaderInvocations;
+} GpuPipelineStatistics;
+
+typedef struct GpuProfilerFrame
+{
+	const char* scopeNames[GPU_PROFILER_MAX_SCOPES];
+	uint32_t scopeDepths[GPU_PROFILER_MAX_SCOPES];
+	uint32_t scopeCount;
+	bool statisticsRecorded;
+	bool recorded;
+} GpuProfilerFrame;
+
+//Every frame slot owns a range of timestamp queries and one pipeline statistics query.
+//A slot's results are read when the slot is begun again, which is after the GPU finished it, so reading never stalls.
+typedef struct GpuProfiler
+{
+	VkDevice device;
+	VkQueryPool timestampQueryPool;
+	VkQueryPool statisticsQueryPool;
+	double nanosecondsPerTick;
+	uint64_t timestampMask;
+	bool hostQueryReset;
+	uint32_t frameCount;
+	uint32_t currentFrame;
+	GpuProfilerFrame frames[GPU_PROFILER_MAX_FRAMES];
+	uint32_t openScopes[GPU_PROFILER_MAX_SCOPES];
+	uint32_t openScopeCount;
+	uint32_t untrackedScopeCount;
+	GpuScopeResult results[GPU_PROFILER_MAX_SCOPES];
+	uint32_t resultCount;
+	GpuPipelineStatistics statistics;
+	bool hasStatistics;
+} GpuProfiler;
+
+//Pipeline statistics need the pipelineStatisticsQuery feature and hostQueryReset the feature of the same name.
+//Timestamps are skipped when the queue family has no valid timestamp bits, or when it can't reset queries and hostQueryReset is false.
+bool CreateGpuProfiler(VkDevice device,VkPhysicalDevice physicalDevice,uint32_t queueFamilyIndex,uint32_t frameCount,bool pipelineStatistics,bool hostQueryReset,GpuProfiler* outProfiler);
+void DestroyGpuProfiler(GpuProfiler* profiler);
+//Makes the slot's results the current ones, once the GPU finished it; returns false when the slot has no new results yet.
+//BeginGpuProfilerFrame does this too, so it's only needed for slots that may not be reused soon.
+bool ReadGpuProfilerFrame(GpuProfiler* profiler,uint32_t frame);
+//Has to be called after waiting for the GPU to finish the frame that last used the slot, and outside a render pass.
+void BeginGpuProfilerFrame(GpuProfiler* profiler,VkCommandBuffer commandBuffer,uint32_t frame);
+//Scopes nest, and the name has to stay valid until the results are read, e.g. a string literal; it's also used as a debug label.
+void BeginGpuScope(GpuProfiler* profiler,VkCommandBuffer commandBuffer,const char* name);
+void EndGpuScope(GpuProfiler* profiler,VkCommandBuffer commandBuffer);
+//Counts everything recorded in between, including secondary command buffers that inherit the query.
+void BeginGpuPipelineStatistics(GpuProfiler* profiler,VkCommandBuffer commandBuffer);
+void EndGpuPipelineStatistics(GpuProfiler* profiler,VkCommandBuffer commandBuffer);
+VkQueryPipelineStatisticFlags GetGpuPipelineStatisticFlags(const GpuProfiler* profiler);
+
+#endif
\ No newline at end of file
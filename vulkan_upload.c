@@ -0,0 +1,336 @@
+#include "vulkan_upload.h"
+
+#include <string.h>
+
+#define STAGING_ALIGNMENT 16
+
+//The oldest batch has to be finished by the GPU already.
+static void ReleaseOldestBatch(UploadQueue* queue)
+{
+	UploadBatch* batch = &queue->batches[queue->oldestPendingBatch];
+	if(queue->profiler && ReadGpuProfilerFrame(queue->profiler,queue->oldestPendingBatch) && queue->profiler->resultCount > 0)
+	{
+		queue->gpuMilliseconds += queue->profiler->results[0].milliseconds;
+		++queue->timedBatchCount;
+	}
+	batch->pending = false;
+	batch->uploadCount = 0;
+	queue->oldestPendingBatch = (queue->oldestPendingBatch + 1) % UPLOAD_BATCH_COUNT;
+}
+
+static bool RetireOldestBatch(UploadQueue* queue)
+{
+	UploadBatch* batch = &queue->batches[queue->oldestPendingBatch];
+	VkResult result = vkWaitForFences(queue->device,1,&batch->fence,VK_TRUE,UINT64_MAX);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkWaitForFences(queue->device,1,&batch->fence,VK_TRUE,UINT64_MAX) returned %s.",VkResultToString(result));
+		return false;
+	}
+	ReleaseOldestBatch(queue);
+	return true;
+}
+
+//Doesn't wait; batches finish in submission order, so it stops at the first one that's still running.
+static void RetireFinishedBatches(UploadQueue* queue)
+{
+	while(queue->batches[queue->oldestPendingBatch].pending && vkGetFenceStatus(queue->device,queue->batches[queue->oldestPendingBatch].fence) == VK_SUCCESS)
+	{
+		ReleaseOldestBatch(queue);
+	}
+}
+
+static bool BeginBatch(UploadQueue* queue)
+{
+	UploadBatch* batch = &queue->batches[queue->currentBatch];
+	if(batch->pending && !RetireOldestBatch(queue))
+	{
+		return false;
+	}
+	VkResult result = vkResetCommandPool(queue->device,batch->commandPool,0);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkResetCommandPool(queue->device,batch->commandPool,0) returned %s.",VkResultToString(result));
+		return false;
+	}
+	result = vkBeginCommandBuffer(batch->commandBuffer,&(VkCommandBufferBeginInfo){
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	});
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkBeginCommandBuffer(batch->commandBuffer,...) returned %s.",VkResultToString(result));
+		return false;
+	}
+	if(queue->profiler)
+	{
+		BeginGpuProfilerFrame(queue->profiler,batch->commandBuffer,queue->currentBatch);
+		BeginGpuScope(queue->profiler,batch->commandBuffer,"Texture uploads");
+	}
+	return true;
+}
+
+//Finds room for size bytes in the ring, submitting and waiting for older batches when it's full.
+static bool ReserveStaging(UploadQueue* queue,VkDeviceSize size,VkDeviceSize* outOffset)
+{
+	VkDeviceSize capacity = queue->stagingBuffer.size;
+	size = (size + STAGING_ALIGNMENT - 1) & ~(VkDeviceSize)(STAGING_ALIGNMENT - 1);
+	if(size >= capacity)
+	{
+		SetError("Upload of %llu bytes doesn't fit into the %llu byte staging ring.",(unsigned long long)size,(unsigned long long)capacity);
+		return false;
+	}
+	while(true)
+	{
+		UploadBatch* current = &queue->batches[queue->currentBatch];
+		bool anyPending = queue->batches[queue->oldestPendingBatch].pending;
+		if(!anyPending && current->uploadCount == 0)
+		{
+			queue->stagingHead = 0;
+			*outOffset = 0;
+			return true;
+		}
+		//Strict comparisons keep the head from ever catching up with the tail, so head == tail always means empty.
+		VkDeviceSize tail = anyPending ? queue->batches[queue->oldestPendingBatch].stagingBegin : current->stagingBegin;
+		if(queue->stagingHead > tail)
+		{
+			if(queue->stagingHead + size <= capacity)
+			{
+				*outOffset = queue->stagingHead;
+				return true;
+			}
+			if(size < tail)
+			{
+				*outOffset = 0;
+				return true;
+			}
+		}
+		else if(queue->stagingHead + size < tail)
+		{
+			*outOffset = queue->stagingHead;
+			return true;
+		}
+
+		if(!anyPending)
+		{
+			if(!FlushUploads(queue))
+			{
+				return false;
+			}
+		}
+		else if(!RetireOldestBatch(queue))
+		{
+			return false;
+		}
+	}
+}
+
+bool CreateUploadQueue(VkDevice device,MemoryAllocator* allocator,VkQueue queue,uint32_t queueFamilyIndex,VkDeviceSize stagingSize,UploadQueue* outQueue)
+{
+	*outQueue = (UploadQueue){
+		.device = device,
+		.allocator = allocator,
+		.queue = queue,
+		.queueFamilyIndex = queueFamilyIndex
+	};
+	if(!CreateRenderingBuffer(device,allocator,stagingSize,NULL,VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,VK_BUFFER_USAGE_TRANSFER_SRC_BIT,MEMORY_STRATEGY_LINEAR,&outQueue->stagingBuffer))
+	{
+		return false;
+	}
+
+	VkResult result = vkCreateSemaphore(device,&(VkSemaphoreCreateInfo){
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &(VkSemaphoreTypeCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue = 0
+		}
+	},NULL,&outQueue->timelineSemaphore);
+	if(result != VK_SUCCESS)
+	{
+		DestroyUploadQueue(outQueue);
+		SetError("Function call vkCreateSemaphore(device,...,NULL,&outQueue->timelineSemaphore) returned %s.",VkResultToString(result));
+		return false;
+	}
+
+	for(uint32_t i = 0;i < UPLOAD_BATCH_COUNT;++i)
+	{
+		UploadBatch* batch = &outQueue->batches[i];
+		result = vkCreateCommandPool(device,&(VkCommandPoolCreateInfo){
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = queueFamilyIndex
+		},NULL,&batch->commandPool);
+		if(result != VK_SUCCESS)
+		{
+			DestroyUploadQueue(outQueue);
+			SetError("Function call vkCreateCommandPool(device,...,NULL,&batch->commandPool) returned %s.",VkResultToString(result));
+			return false;
+		}
+		result = vkAllocateCommandBuffers(device,&(VkCommandBufferAllocateInfo){
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = batch->commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		},&batch->commandBuffer);
+		if(result != VK_SUCCESS)
+		{
+			DestroyUploadQueue(outQueue);
+			SetError("Function call vkAllocateCommandBuffers(device,...,&batch->commandBuffer) returned %s.",VkResultToString(result));
+			return false;
+		}
+		result = vkCreateFence(device,&(VkFenceCreateInfo){.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO},NULL,&batch->fence);
+		if(result != VK_SUCCESS)
+		{
+			DestroyUploadQueue(outQueue);
+			SetError("Function call vkCreateFence(device,...,NULL,&batch->fence) returned %s.",VkResultToString(result));
+			return false;
+		}
+	}
+	return true;
+}
+
+void DestroyUploadQueue(UploadQueue* queue)
+{
+	if(queue->queue)
+	{
+		vkQueueWaitIdle(queue->queue);
+	}
+	for(uint32_t i = 0;i < UPLOAD_BATCH_COUNT;++i)
+	{
+		vkDestroyFence(queue->device,queue->batches[i].fence,NULL);
+		vkDestroyCommandPool(queue->device,queue->batches[i].commandPool,NULL);
+	}
+	vkDestroySemaphore(queue->device,queue->timelineSemaphore,NULL);
+	DestroyRenderingBuffer(queue->device,queue->stagingBuffer);
+	*queue = (UploadQueue){0};
+}
+
+bool QueueImageUpload(UploadQueue* queue,const uint8_t* texels,RenderingImage image,uint64_t* outUploadValue)
+{
+	VkDeviceSize offset = 0;
+	if(!ReserveStaging(queue,image.size,&offset))
+	{
+		return false;
+	}
+	UploadBatch* batch = &queue->batches[queue->currentBatch];
+	if(batch->uploadCount == 0)
+	{
+		if(!BeginBatch(queue))
+		{
+			return false;
+		}
+		batch->stagingBegin = offset;
+	}
+	memcpy((uint8_t*)queue->stagingBuffer.allocation.mappedData + offset,texels,image.size);
+	queue->stagingHead = offset + ((image.size + STAGING_ALIGNMENT - 1) & ~(VkDeviceSize)(STAGING_ALIGNMENT - 1));
+
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.image = image.image,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.layerCount = 1,
+			.levelCount = 1
+		}
+	};
+	vkCmdPipelineBarrier(batch->commandBuffer,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT,0,0,NULL,0,NULL,1,&barrier);
+
+	VkBufferImageCopy bufferImageCopy = {
+		.bufferOffset = offset,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageOffset = {0,0,0},
+		.imageExtent = {image.imageExtent.width,image.imageExtent.height,1},
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.layerCount = 1
+		}
+	};
+	vkCmdCopyBufferToImage(batch->commandBuffer,queue->stagingBuffer.buffer,image.image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,&bufferImageCopy);
+
+	//The transfer queue may not know fragment shader stages; visibility for the graphics queue comes from the timeline semaphore wait.
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(batch->commandBuffer,VK_PIPELINE_STAGE_TRANSFER_BIT,VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,0,0,NULL,0,NULL,1,&barrier);
+
+	++batch->uploadCount;
+	if(outUploadValue)
+	{
+		*outUploadValue = queue->submittedValue + 1;
+	}
+	return true;
+}
+
+bool FlushUploads(UploadQueue* queue)
+{
+	//Flushing is done every frame, so finished batches get their staging space and timings back without waiting for the batch to be reused.
+	RetireFinishedBatches(queue);
+	UploadBatch* batch = &queue->batches[queue->currentBatch];
+	if(batch->uploadCount == 0)
+	{
+		return true;
+	}
+	if(queue->profiler)
+	{
+		EndGpuScope(queue->profiler,batch->commandBuffer);
+	}
+	VkResult result = vkEndCommandBuffer(batch->commandBuffer);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkEndCommandBuffer(batch->commandBuffer) returned %s.",VkResultToString(result));
+		return false;
+	}
+	result = vkResetFences(queue->device,1,&batch->fence);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkResetFences(queue->device,1,&batch->fence) returned %s.",VkResultToString(result));
+		return false;
+	}
+
+	uint64_t signalValue = queue->submittedValue + 1;
+	VkSubmitInfo submitInfo = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &(VkTimelineSemaphoreSubmitInfo){
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.signalSemaphoreValueCount = 1,
+			.pSignalSemaphoreValues = &signalValue
+		},
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch->commandBuffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &queue->timelineSemaphore
+	};
+	result = vkQueueSubmit(queue->queue,1,&submitInfo,batch->fence);
+	if(result != VK_SUCCESS)
+	{
+		SetError("Function call vkQueueSubmit(queue->queue,1,&submitInfo,batch->fence) returned %s.",VkResultToString(result));
+		return false;
+	}
+	queue->submittedValue = signalValue;
+	if(!queue->batches[queue->oldestPendingBatch].pending)
+	{
+		queue->oldestPendingBatch = queue->currentBatch;
+	}
+	batch->pending = true;
+	queue->currentBatch = (queue->currentBatch + 1) % UPLOAD_BATCH_COUNT;
+	return true;
+}
+
+bool IsUploadComplete(UploadQueue* queue,uint64_t uploadValue)
+{
+	if(uploadValue > queue->submittedValue)
+	{
+		return false;
+	}
+	uint64_t completedValue = 0;
+	return vkGetSemaphoreCounterValue(queue->device,queue->timelineSemaphore,&completedValue) == VK_SUCCESS && completedValue >= uploadValue;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef VULKAN_UPLOAD_H
+#define VULKAN_UPLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vulkan.h"
+#include "vulkan_image.h"
+#include "vulkan_buffer.h"
+#include "vulkan_memory.h"
+#include "vulkan_profiler.h"
+
+#define UPLOAD_BATCH_COUNT 4
+
+typedef struct UploadBatch
+{
+	VkCommandPool commandPool;
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+	VkDeviceSize stagingBegin;
+	size_t uploadCount;
+	bool pending;
+} UploadBatch;
+
+//Copies go through a staging ring and are recorded into batches; every submitted batch signals a fence and the next value of a timeline semaphore.
+typedef struct UploadQueue
+{
+	VkDevice device;
+	MemoryAllocator* allocator;
+	VkQueue queue;
+	uint32_t queueFamilyIndex;
+	RenderingBuffer stagingBuffer;
+	VkDeviceSize stagingHead;
+	UploadBatch batches[UPLOAD_BATCH_COUNT];
+	uint32_t currentBatch;
+	uint32_t oldestPendingBatch;
+	VkSemaphore timelineSemaphore;
+	uint64_t submittedValue;
+	//Optional; when set, every batch is a timed scope in the slot of its batch index, which is read when the batch is retired.
+	GpuProfiler* profiler;
+	//GPU time of all retired batches.
+	double gpuMilliseconds;
+	uint32_t timedBatchCount;
+} UploadQueue;
+
+bool CreateUploadQueue(VkDevice device,MemoryAllocator* allocator,VkQueue queue,uint32_t queueFamilyIndex,VkDeviceSize stagingSize,UploadQueue* outQueue);
+void DestroyUploadQueue(UploadQueue* queue);
+//The image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL once the returned timeline value is reached.
+bool QueueImageUpload(UploadQueue* queue,const uint8_t* texels,RenderingImage image,uint64_t* outUploadValue);
+bool FlushUploads(UploadQueue* queue);
+bool IsUploadComplete(UploadQueue* queue,uint64_t uploadValue);
+
+#endif
\ No newline at end of file